@@ -0,0 +1,186 @@
+#include "analyse.h"
+#include "bitbase.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Job {
+    uint64_t seq;
+    uint64_t lineNo;
+    std::string line;
+};
+
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t\r\n"), e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+// The four FEN fields and the operations after them, split at semicolons
+// outside quoted operands.
+bool split_epd(const std::string &line, std::string &fen, std::vector<std::string> &ops) {
+    std::istringstream ss(line);
+    std::string field;
+    for (int i = 0; i < 4; ++i) {
+        if (!(ss >> field)) return false;
+        fen += (i ? " " : "") + field;
+    }
+    std::string rest, op;
+    std::getline(ss, rest);
+    bool quoted = false;
+    for (char c : rest) {
+        if (c == '"') quoted = !quoted;
+        if (c == ';' && !quoted) {
+            if (!trim(op).empty()) ops.push_back(trim(op));
+            op.clear();
+        } else op += c;
+    }
+    if (!trim(op).empty()) ops.push_back(trim(op));
+    return true;
+}
+
+std::string opcode(const std::string &op) { return op.substr(0, op.find(' ')); }
+
+std::string json_string(const std::string &s) {
+    std::string r = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        if ((unsigned char)c >= 0x20) r += c;
+    }
+    return r + "\"";
+}
+
+std::string analyse_line(Searcher &searcher, const Job &job, const AnalyseOptions &opts) {
+    std::string fen;
+    std::vector<std::string> ops;
+    Board b;
+    if (!split_epd(job.line, fen, ops) || !b.set_fen(fen)) {
+        if (opts.json) return "{\"line\":" + std::to_string(job.lineNo) + ",\"error\":\"invalid position\"}";
+        return trim(job.line) + " c0 \"invalid position\";";
+    }
+    searcher.new_position();
+    SearchResult res = searcher.search(b, opts.limits);
+    uint64_t nodes = searcher.node_count();
+    // A checkmated side has no move and is reported as mate 0
+    int mate = res.mate;
+    bool isMate = mate != 0 || (!res.best && b.in_check(b.side()));
+
+    std::string out;
+    if (opts.json) {
+        out = "{\"line\":" + std::to_string(job.lineNo) + ",\"fen\":" + json_string(fen);
+        for (const std::string &op : ops)
+            if (opcode(op) == "id") {
+                std::string id = trim(op.substr(2));
+                if (id.size() >= 2 && id.front() == '"' && id.back() == '"') id = id.substr(1, id.size() - 2);
+                out += ",\"id\":" + json_string(id);
+            }
+        out += ",\"bestmove\":" + (res.best ? json_string(move_to_string(res.best)) : std::string("null"));
+        out += isMate ? ",\"score\":{\"mate\":" + std::to_string(mate) + "}"
+                      : ",\"score\":{\"cp\":" + std::to_string(res.score) + "}";
+        out += ",\"depth\":" + std::to_string(res.depth) + ",\"nodes\":" + std::to_string(nodes) + ",\"pv\":[";
+        for (size_t i = 0; res.best && i < res.pv.size(); ++i)
+            out += (i ? "," : "") + json_string(move_to_string(res.pv[i]));
+        return out + "]}";
+    }
+    // Earlier analysis results in the input are replaced
+    out = fen;
+    for (const std::string &op : ops) {
+        std::string code = opcode(op);
+        if (code != "acd" && code != "acn" && code != "ce" && code != "dm" && code != "pv") out += " " + op + ";";
+    }
+    out += " acd " + std::to_string(res.depth) + "; acn " + std::to_string(nodes) + ";";
+    out += isMate ? " dm " + std::to_string(mate) + ";" : " ce " + std::to_string(res.score) + ";";
+    if (res.best) {
+        out += " pv";
+        for (Move m : res.pv) out += " " + move_to_string(m);
+        out += ";";
+    }
+    return out;
+}
+
+} // namespace
+
+bool analyse(const std::string &path, const AnalyseOptions &opts, std::ostream &out, std::ostream &log,
+             std::string &error) {
+    std::ifstream in(path);
+    if (!in) { error = "cannot open " + path; return false; }
+    const int jobs = std::max(1, opts.jobs);
+    // Built up front so results do not depend on when tables appear
+    if (!bitbase::init(jobs, "", error)) return false;
+
+    // The reader stays at most 'window' lines ahead of the writer, which
+    // bounds both the queue and the results waiting for an earlier line.
+    const uint64_t window = (uint64_t)jobs * 4;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> queue;
+    std::map<uint64_t, std::string> finished;
+    uint64_t nextRead = 0, nextWrite = 0;
+    bool eof = false;
+
+    // Created one after another: each Searcher starts with the default TT
+    // before it is resized, and that peak should not be paid per job at once
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    for (int j = 0; j < jobs; ++j) {
+        searchers.emplace_back(new Searcher()); // single thread, no infoSink: silent
+        searchers.back()->set_tt_mb(opts.hashMb);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int j = 0; j < jobs; ++j) {
+        workers.emplace_back([&, j] {
+            Searcher &searcher = *searchers[j];
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return !queue.empty() || eof; });
+                    if (queue.empty()) return;
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                }
+                std::string result = analyse_line(searcher, job, opts);
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.emplace(job.seq, std::move(result));
+                while (!finished.empty() && finished.begin()->first == nextWrite) {
+                    out << finished.begin()->second << '\n';
+                    finished.erase(finished.begin());
+                    ++nextWrite;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    std::string line;
+    uint64_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        std::string t = trim(line);
+        if (t.empty() || t[0] == '#') continue;
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return nextRead - nextWrite < window; });
+        queue.push_back({nextRead++, lineNo, std::move(line)});
+        cv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        eof = true;
+    }
+    cv.notify_all();
+    for (auto &w : workers) w.join();
+    out.flush();
+
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    log << "analysed " << nextRead << " positions in " << ms << " ms with " << jobs << " jobs" << std::endl;
+    return true;
+}
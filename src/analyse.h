@@ -0,0 +1,24 @@
+#pragma once
+
+#include "search.h"
+#include <ostream>
+#include <string>
+
+struct AnalyseOptions {
+    SearchLimits limits;   // depth, nodes or movetime per position
+    int jobs = 1;          // positions searched in parallel, one thread each
+    int hashMb = 16;       // TT size per job
+    bool json = false;     // JSON lines instead of EPD
+};
+
+// Streams an EPD file through 'jobs' independent single-threaded searchers,
+// each with its own TT, and writes one result per position in input order:
+// the EPD line with acd/acn/ce (or dm)/pv operations, or a JSON object with
+// bestmove, score, depth, nodes and pv. Moves are in UCI notation. Every
+// position starts from cleared history and a TT whose earlier entries read
+// as empty (hidden by generation, not zeroed), so a depth or node limited
+// run gives the same output for any number of jobs. At most a few lines per
+// job are held in memory, whatever the file size. A summary with the
+// position count and time goes to 'log'.
+bool analyse(const std::string &path, const AnalyseOptions &opts, std::ostream &out, std::ostream &log,
+             std::string &error);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+struct BenchOptions {
+    int depth = 10;
+    int hashMb = 16;
+    int threads = 1;   // node counts are only reproducible with one thread
+};
+
+// Searches the built-in position set to a fixed depth, each from a fresh
+// TT and history, and prints per-position and total node counts plus NPS.
+// The total is a signature of the search: any change to it means the tree
+// changed. Returns the total node count.
+uint64_t bench(const BenchOptions &opts, std::ostream &out);
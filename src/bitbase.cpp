@@ -0,0 +1,448 @@
+#include "bitbase.h"
+#include "bitboard.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bitbase {
+
+namespace {
+
+// Generation order matters: KPK looks up its promotions in KQK and KRK.
+enum TableId { KQK, KRK, KPK, KBNK, TABLE_COUNT };
+
+struct TableDef {
+    int pieceCount;        // strong pieces besides the king
+    PieceType pieces[2];
+    int material;          // added to KNOWN_WIN for a won position
+    int kingSquares;       // strong king squares left after symmetry
+};
+
+// Pawnless tables keep the strong king in the a1-d1-d4 triangle; KPK can
+// only be mirrored left-right, which leaves files a-d.
+const TableDef TABLES[TABLE_COUNT] = {
+    {1, {QUEEN, NO_PIECE_TYPE}, 900, 10},
+    {1, {ROOK, NO_PIECE_TYPE}, 500, 10},
+    {1, {PAWN, NO_PIECE_TYPE}, 100, 32},
+    {2, {BISHOP, KNIGHT}, 650, 10},
+};
+
+constexpr size_t HEADER_BYTES = 64;
+constexpr char MAGIC[8] = {'M', 'A', 'S', 'B', 'B', '0', '0', '1'};
+
+size_t table_positions(int t) { return size_t(2 * TABLES[t].kingSquares) << (6 + 6 * TABLES[t].pieceCount); }
+size_t table_words(int t) { return (table_positions(t) + 63) / 64; }
+
+// Decoded index; the strong side is always White.
+struct Pos {
+    int stm; // 0 = strong side to move
+    Square wk, bk;
+    Square p[2];
+};
+
+// Strong king square <-> its slot in the index, per symmetry class
+struct KingSlots {
+    int slot[64];
+    Square square[32];
+};
+
+KingSlots make_king_slots(bool pawns) {
+    KingSlots ks{};
+    int n = 0;
+    for (int s = 0; s < 64; ++s) {
+        int f = FILE_OF((Square)s), r = RANK_OF((Square)s);
+        bool keep = pawns ? f <= 3 : (f <= 3 && r <= f);
+        ks.slot[s] = keep ? n : -1;
+        if (keep) ks.square[n++] = (Square)s;
+    }
+    return ks;
+}
+
+const KingSlots PAWNLESS_KINGS = make_king_slots(false);
+const KingSlots PAWN_KINGS = make_king_slots(true);
+
+inline const KingSlots &king_slots(const TableDef &td) {
+    return td.kingSquares == 10 ? PAWNLESS_KINGS : PAWN_KINGS;
+}
+
+inline Square flip_file(Square s) { return (Square)(s ^ 7); }
+inline Square flip_rank(Square s) { return (Square)(s ^ 56); }
+inline Square flip_diagonal(Square s) { return (Square)(((s >> 3) | (s << 3)) & 63); }
+
+template <typename Flip>
+inline void transform(const TableDef &td, Pos &p, Flip flip) {
+    p.wk = flip(p.wk);
+    p.bk = flip(p.bk);
+    for (int i = 0; i < td.pieceCount; ++i) p.p[i] = flip(p.p[i]);
+}
+
+// Maps p to the orientation stored in the table. Positions with the strong
+// king on a1-h8 are not folded across that diagonal: both orientations have
+// an entry, so that no position is its own mirror image.
+inline void canonicalise(const TableDef &td, Pos &p) {
+    if (FILE_OF(p.wk) > 3) transform(td, p, flip_file);
+    if (td.kingSquares == 10) {
+        if (RANK_OF(p.wk) > 3) transform(td, p, flip_rank);
+        if (RANK_OF(p.wk) > FILE_OF(p.wk)) transform(td, p, flip_diagonal);
+    }
+}
+
+inline bool on_diagonal(const TableDef &td, Square wk) {
+    return td.kingSquares == 10 && FILE_OF(wk) == RANK_OF(wk);
+}
+
+inline size_t index_of(const TableDef &td, const Pos &p) {
+    size_t idx = (size_t)p.bk;
+    for (int i = 0; i < td.pieceCount; ++i) idx |= (size_t)p.p[i] << (6 + 6 * i);
+    return (idx * td.kingSquares + king_slots(td).slot[p.wk]) * 2 + p.stm;
+}
+
+inline size_t encode(const TableDef &td, Pos p) {
+    canonicalise(td, p);
+    return index_of(td, p);
+}
+
+inline Pos decode(const TableDef &td, size_t idx) {
+    Pos p;
+    p.stm = (int)(idx & 1);
+    idx >>= 1;
+    p.wk = king_slots(td).square[idx % td.kingSquares];
+    idx /= td.kingSquares;
+    p.bk = (Square)(idx & 63);
+    p.p[0] = p.p[1] = SQ_NONE;
+    for (int i = 0; i < td.pieceCount; ++i) p.p[i] = (Square)((idx >> (6 + 6 * i)) & 63);
+    return p;
+}
+
+inline Bitboard piece_attacks(PieceType pt, Square s, Bitboard occ) {
+    switch (pt) {
+        case PAWN:   return PAWN_ATTACKS[WHITE][s];
+        case KNIGHT: return KNIGHT_ATTACKS[s];
+        case BISHOP: return bishop_attacks(s, occ);
+        case ROOK:   return rook_attacks(s, occ);
+        case QUEEN:  return queen_attacks(s, occ);
+        default:     return KING_ATTACKS[s];
+    }
+}
+
+inline Bitboard strong_attacks(const TableDef &td, const Pos &p, Bitboard occ) {
+    Bitboard a = KING_ATTACKS[p.wk];
+    for (int i = 0; i < td.pieceCount; ++i) a |= piece_attacks(td.pieces[i], p.p[i], occ);
+    return a;
+}
+
+inline Bitboard occupancy(const TableDef &td, const Pos &p) {
+    Bitboard occ = bit(p.wk) | bit(p.bk);
+    for (int i = 0; i < td.pieceCount; ++i) occ |= bit(p.p[i]);
+    return occ;
+}
+
+bool is_legal(const TableDef &td, const Pos &p) {
+    Bitboard occ = occupancy(td, p);
+    if (popcount(occ) != 2 + td.pieceCount) return false;
+    if (KING_ATTACKS[p.wk] & bit(p.bk)) return false;
+    for (int i = 0; i < td.pieceCount; ++i)
+        if (td.pieces[i] == PAWN && (RANK_OF(p.p[i]) == 0 || RANK_OF(p.p[i]) == 7)) return false;
+    // The weak king cannot be in check with the strong side to move
+    return p.stm == 1 || !(strong_attacks(td, p, occ) & bit(p.bk));
+}
+
+// Runs fn(begin, end, thread) over [0, n) split into one range per thread.
+template <typename Fn>
+void parallel_for(int threads, size_t n, Fn fn) {
+    if (threads <= 1 || n < 4096) { fn(size_t(0), n, 0); return; }
+    std::vector<std::thread> pool;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        size_t begin = std::min(n, t * chunk), end = std::min(n, begin + chunk);
+        pool.emplace_back([=, &fn] { fn(begin, end, t); });
+    }
+    for (auto &th : pool) th.join();
+}
+
+std::mutex initMutex;
+std::atomic<const uint64_t *> tables[TABLE_COUNT];
+std::vector<uint64_t> heap[TABLE_COUNT];
+
+struct Mapping {
+    void *addr = nullptr;
+    size_t size = 0;
+} mapping;
+
+inline bool win_bit(const uint64_t *t, size_t idx) { return (t[idx >> 6] >> (idx & 63)) & 1; }
+
+// Retrograde analysis of one table. Positions with the weak side to move
+// keep a count of their moves not yet known to lose; when it drops to zero
+// the position is lost, and every strong-side predecessor of it is won.
+// Each ply of the frontier is processed in parallel.
+std::vector<uint64_t> generate(int t, int threads) {
+    const TableDef &td = TABLES[t];
+    const int n = td.pieceCount;
+    const size_t size = table_positions(t);
+    std::unique_ptr<std::atomic<uint64_t>[]> win(new std::atomic<uint64_t>[size / 64]);
+    std::unique_ptr<std::atomic<uint8_t>[]> movesLeft(new std::atomic<uint8_t>[size / 2]);
+    for (size_t i = 0; i < size / 64; ++i) win[i].store(0, std::memory_order_relaxed);
+
+    // Most predecessors are already won: test before the atomic update
+    auto is_win = [&](size_t idx) { return (win[idx >> 6].load(std::memory_order_relaxed) >> (idx & 63)) & 1; };
+    auto set_win = [&](size_t idx) {
+        uint64_t mask = ONE << (idx & 63);
+        return !(win[idx >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    };
+
+    std::vector<std::vector<uint32_t>> found(std::max(threads, 1));
+
+    // Seed: mates, stalemates and move counts for the weak side; winning
+    // promotions for the strong side.
+    const uint64_t *kqk = tables[KQK].load(std::memory_order_acquire);
+    const uint64_t *krk = tables[KRK].load(std::memory_order_acquire);
+    parallel_for(threads, size, [&](size_t begin, size_t end, int thread) {
+        for (size_t idx = begin; idx < end; ++idx) {
+            Pos p = decode(td, idx);
+            if (p.stm == 1) movesLeft[idx >> 1].store(0, std::memory_order_relaxed);
+            if (!is_legal(td, p)) continue;
+            Bitboard occ = occupancy(td, p);
+            if (p.stm == 1) {
+                Bitboard attacked = strong_attacks(td, p, occ ^ bit(p.bk));
+                Bitboard moves = KING_ATTACKS[p.bk] & ~attacked;
+                movesLeft[idx >> 1].store((uint8_t)popcount(moves), std::memory_order_relaxed);
+                if (!moves && (attacked & bit(p.bk)) && set_win(idx)) found[thread].push_back((uint32_t)idx);
+            } else if (t == KPK && RANK_OF(p.p[0]) == 6 && !(occ & bit((Square)(p.p[0] + 8)))) {
+                Pos q = p;
+                q.stm = 1;
+                q.p[0] = (Square)(p.p[0] + 8);
+                size_t promoted = encode(TABLES[KQK], q); // KRK shares the layout
+                if ((win_bit(kqk, promoted) || win_bit(krk, promoted)) && set_win(idx))
+                    found[thread].push_back((uint32_t)idx);
+            }
+        }
+    });
+
+    std::vector<uint32_t> frontier;
+    while (true) {
+        frontier.clear();
+        for (auto &f : found) {
+            frontier.insert(frontier.end(), f.begin(), f.end());
+            f.clear();
+        }
+        if (frontier.empty()) break;
+        parallel_for(threads, frontier.size(), [&](size_t begin, size_t end, int thread) {
+            auto &out = found[thread];
+            for (size_t i = begin; i < end; ++i) {
+                Pos p = decode(td, frontier[i]);
+                Bitboard occ = occupancy(td, p);
+                if (p.stm == 1) {
+                    // Lost for the weak side: un-move each strong piece
+                    for (int k = -1; k < n; ++k) {
+                        Square s = k < 0 ? p.wk : p.p[k];
+                        PieceType pt = k < 0 ? KING : td.pieces[k];
+                        Bitboard from;
+                        if (pt == KING) from = KING_ATTACKS[s] & ~occ & ~KING_ATTACKS[p.bk];
+                        else if (pt == PAWN) {
+                            from = 0;
+                            Square back = (Square)(s - 8);
+                            if (RANK_OF(s) >= 2 && !(occ & bit(back))) {
+                                from |= bit(back);
+                                if (RANK_OF(s) == 3 && !(occ & bit((Square)(s - 16)))) from |= bit((Square)(s - 16));
+                            }
+                        } else from = piece_attacks(pt, s, occ) & ~occ;
+                        while (from) {
+                            Pos q = p;
+                            q.stm = 0;
+                            (k < 0 ? q.wk : q.p[k]) = pop_lsb_sq(from);
+                            if (strong_attacks(td, q, occupancy(td, q)) & bit(q.bk)) continue;
+                            // p stands for its mirror image too, so a
+                            // predecessor on the diagonal wins both ways
+                            canonicalise(td, q);
+                            for (int mirror = 0; mirror < 2; ++mirror) {
+                                if (mirror) {
+                                    if (!on_diagonal(td, q.wk)) break;
+                                    transform(td, q, flip_diagonal);
+                                }
+                                size_t qi = index_of(td, q);
+                                if (!is_win(qi) && set_win(qi)) out.push_back((uint32_t)qi);
+                            }
+                        }
+                    }
+                } else {
+                    // Won for the strong side: un-move the weak king
+                    Bitboard from = KING_ATTACKS[p.bk] & ~occ & ~KING_ATTACKS[p.wk];
+                    while (from) {
+                        Pos q = p;
+                        q.stm = 1;
+                        q.bk = pop_lsb_sq(from);
+                        size_t qi = encode(td, q);
+                        if (movesLeft[qi >> 1].fetch_sub(1, std::memory_order_relaxed) == 1 && set_win(qi))
+                            out.push_back((uint32_t)qi);
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<uint64_t> bits(size / 64);
+    for (size_t i = 0; i < bits.size(); ++i) bits[i] = win[i].load(std::memory_order_relaxed);
+    return bits;
+}
+
+bool map_cache(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+    size_t expected = HEADER_BYTES;
+    for (int t = 0; t < TABLE_COUNT; ++t) expected += table_words(t) * sizeof(uint64_t);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) { close(fd); return false; }
+    void *map = mmap(nullptr, expected, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    const unsigned char *data = static_cast<const unsigned char *>(map);
+    uint32_t count;
+    memcpy(&count, data + sizeof(MAGIC), sizeof(count));
+    if (memcmp(data, MAGIC, sizeof(MAGIC)) || count != TABLE_COUNT) {
+        munmap(map, expected);
+        return false;
+    }
+    mapping.addr = map;
+    mapping.size = expected;
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(data + HEADER_BYTES);
+    for (int t = 0; t < TABLE_COUNT; ++t) {
+        tables[t].store(words, std::memory_order_release);
+        words += table_words(t);
+    }
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool write_cache(const std::string &path, std::string &error) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) { error = "cannot write " + path; return false; }
+    char header[HEADER_BYTES] = {};
+    uint32_t count = TABLE_COUNT;
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    memcpy(header + sizeof(MAGIC), &count, sizeof(count));
+    out.write(header, sizeof(header));
+    for (int t = 0; t < TABLE_COUNT; ++t)
+        out.write(reinterpret_cast<const char *>(tables[t].load(std::memory_order_acquire)),
+                  (std::streamsize)(table_words(t) * sizeof(uint64_t)));
+    if (!out) { error = "cannot write " + path; return false; }
+    return true;
+}
+
+int king_distance(Square a, Square b) {
+    return std::max(std::abs(FILE_OF(a) - FILE_OF(b)), std::abs(RANK_OF(a) - RANK_OF(b)));
+}
+
+// 0 in the centre, 6 in a corner
+int edge_push(Square s) {
+    int f = FILE_OF(s), r = RANK_OF(s);
+    return std::max(3 - f, f - 4) + std::max(3 - r, r - 4);
+}
+
+// Table and normalised index of a covered position, or false.
+bool locate(const Board &b, int &table, size_t &idx) {
+    Bitboard occ = b.occ();
+    int count = popcount(occ);
+    if (count < 3 || count > 4) return false;
+    Color strong = popcount(b.color_bb(WHITE)) > 1 ? WHITE : BLACK;
+    if (popcount(b.color_bb(opposite(strong))) != 1) return false;
+    Pos p;
+    int flip = strong == WHITE ? 0 : 56;
+    p.stm = b.side() == strong ? 0 : 1;
+    p.wk = (Square)(lsb(b.pieces(strong, KING)) ^ flip);
+    p.bk = (Square)(lsb(b.pieces(opposite(strong), KING)) ^ flip);
+    for (table = 0; table < TABLE_COUNT; ++table) {
+        const TableDef &td = TABLES[table];
+        if (count != 2 + td.pieceCount) continue;
+        bool match = true;
+        for (int i = 0; i < td.pieceCount && match; ++i) {
+            Bitboard bb = b.pieces(strong, td.pieces[i]);
+            if (!bb) match = false;
+            else p.p[i] = (Square)(lsb(bb) ^ flip);
+        }
+        if (!match) continue;
+        idx = encode(td, p);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool init(int threads, const std::string &cachePath, std::string &error) {
+    std::lock_guard<std::mutex> lock(initMutex);
+    init_attacks();
+    bool haveCache = !cachePath.empty() && cachePath != "<empty>";
+    if (!ready() && haveCache && map_cache(cachePath)) return true;
+    if (!ready()) {
+        for (int t = 0; t < TABLE_COUNT; ++t) {
+            if (tables[t].load(std::memory_order_acquire)) continue;
+            heap[t] = generate(t, threads);
+            tables[t].store(heap[t].data(), std::memory_order_release);
+        }
+    }
+    // Tables that came from another cache file are already on disk
+    if (haveCache && !mapping.addr) return write_cache(cachePath, error);
+    return true;
+}
+
+bool ready() {
+    for (int t = 0; t < TABLE_COUNT; ++t)
+        if (!tables[t].load(std::memory_order_acquire)) return false;
+    return true;
+}
+
+bool covers(const Board &b) {
+    int t;
+    size_t idx;
+    return locate(b, t, idx);
+}
+
+Outcome probe(const Board &b) {
+    int t;
+    size_t idx;
+    if (!locate(b, t, idx)) return NONE;
+    const uint64_t *bits = tables[t].load(std::memory_order_acquire);
+    if (!bits) return NONE;
+    if (!win_bit(bits, idx)) return DRAW;
+    return (idx & 1) ? LOSS : WIN;
+}
+
+bool evaluate(const Board &b, int &score) {
+    int t;
+    size_t idx;
+    if (!locate(b, t, idx)) return false;
+    const uint64_t *bits = tables[t].load(std::memory_order_acquire);
+    if (!bits) return false;
+    if (!win_bit(bits, idx)) { score = 0; return true; }
+    Pos p = decode(TABLES[t], idx);
+    int v = KNOWN_WIN + TABLES[t].material + 20 * (7 - king_distance(p.wk, p.bk));
+    if (t == KPK) v += 20 * RANK_OF(p.p[0]) - 5 * king_distance(p.wk, p.p[0]);
+    else if (t == KBNK) {
+        // Mate is only forced in a corner of the bishop's colour; count
+        // the weak king's distance to it in diagonals
+        int f = FILE_OF(p.bk), r = RANK_OF(p.bk);
+        bool dark = ((FILE_OF(p.p[0]) + RANK_OF(p.p[0])) & 1) == 0;
+        int corner = dark ? std::min(f + r, 14 - f - r) : 7 - std::abs(f - r);
+        v += 60 * (7 - corner);
+    } else v += 20 * edge_push(p.bk);
+    score = (idx & 1) ? -v : v;
+    return true;
+}
+
+} // namespace bitbase
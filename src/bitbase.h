@@ -0,0 +1,43 @@
+#pragma once
+
+#include "board.h"
+#include <string>
+
+// Win/draw bitbases for KQK, KRK, KPK and KBNK, built by retrograde
+// analysis inside the engine; no tablebase files are needed. One bit per
+// position records whether the side with the extra material wins. Positions
+// are stored with that side as White and mirrored so its king stands in
+// a1-d1-d4 (files a-d for KPK); the index is the side to move, then the
+// king slot, the weak king and the strong pieces (bishop before knight).
+//
+// Cache file layout (little endian, mmap'ed and used in place):
+//   64-byte header: "MASBB001", uint32 table count, zero padding
+//   uint64 win bits of KQK, KRK, KPK, KBNK in that order
+namespace bitbase {
+
+// A won position scores KNOWN_WIN plus material and a progress term that
+// drives the weak king to the edge (the right corner for KBNK) or the pawn
+// forward. It stays below the TT mate band, so real mates still win out.
+constexpr int KNOWN_WIN = 10000;
+
+// Game-theoretic result for the side to move.
+enum Outcome { NONE, DRAW, WIN, LOSS };
+
+// Maps the tables from cachePath if it holds a valid cache, otherwise
+// generates them on 'threads' threads and, if cachePath is set, writes the
+// cache. Safe to run while other threads probe: each table is published
+// once complete. Returns false (keeping whatever was built) on error.
+bool init(int threads, const std::string &cachePath, std::string &error);
+bool ready(); // all tables available
+
+// True if the material matches a table, whether or not it is built yet.
+bool covers(const Board &b);
+
+// NONE if the position is not covered or its table is not built yet.
+Outcome probe(const Board &b);
+
+// Exact evaluation of a covered position: 0 for draws, otherwise
+// +-(KNOWN_WIN + progress) from the side to move's point of view.
+bool evaluate(const Board &b, int &score);
+
+} // namespace bitbase
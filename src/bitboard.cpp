@@ -0,0 +1,127 @@
+#include "bitboard.h"
+#include <random>
+
+Bitboard KNIGHT_ATTACKS[64];
+Bitboard KING_ATTACKS[64];
+Bitboard PAWN_ATTACKS[2][64];
+Bitboard BETWEEN_BB[64][64];
+Bitboard LINE_BB[64][64];
+Magic BISHOP_MAGICS[64];
+Magic ROOK_MAGICS[64];
+
+// Fancy magics: every square gets its own slice of a shared table, sized by
+// the number of relevant occupancy bits (5248 bishop + 102400 rook entries).
+static Bitboard BISHOP_TABLE[5248];
+static Bitboard ROOK_TABLE[102400];
+
+static Bitboard ray_attacks(int s, Bitboard occ, const int dirs[4][2]) {
+    Bitboard a = 0;
+    for (int i=0;i<4;++i) {
+        int f = (s & 7) + dirs[i][0], r = (s >> 3) + dirs[i][1];
+        while (f>=0 && f<8 && r>=0 && r<8) {
+            Bitboard m = ONE << (r*8+f);
+            a |= m;
+            if (occ & m) break;
+            f += dirs[i][0]; r += dirs[i][1];
+        }
+    }
+    return a;
+}
+
+static void init_magics(Magic *magics, Bitboard *table, const int dirs[4][2]) {
+    Bitboard occs[4096], refs[4096];
+#ifndef MAS_USE_PEXT
+    std::mt19937_64 rng(0x5EEDFACEULL);
+    int epoch[4096] = {}, cur = 0;
+#endif
+    Bitboard *next = table;
+
+    for (int s = 0; s < 64; ++s) {
+        Magic &m = magics[s];
+        // Edge squares never block, unless the slider itself sits on that edge.
+        Bitboard edges = ((0xFFULL | 0xFF00000000000000ULL) & ~(0xFFULL << ((s >> 3) * 8))) |
+                         ((0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << (s & 7)));
+        m.mask = ray_attacks(s, 0, dirs) & ~edges;
+        m.shift = 64 - popcount(m.mask);
+        m.attacks = next;
+
+        // Carry-Rippler enumeration of every occupancy subset of the mask.
+        int size = 0;
+        Bitboard b = 0;
+        do {
+            occs[size] = b;
+            refs[size] = ray_attacks(s, b, dirs);
+#ifdef MAS_USE_PEXT
+            m.attacks[_pext_u64(b, m.mask)] = refs[size];
+            (void)occs;
+#endif
+            ++size;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        next += size;
+
+#ifndef MAS_USE_PEXT
+        for (int i = 0; i < size; ) {
+            do {
+                m.magic = rng() & rng() & rng();
+            } while (popcount((m.mask * m.magic) >> 56) < 6);
+            ++cur;
+            for (i = 0; i < size; ++i) {
+                unsigned idx = m.index(occs[i]);
+                if (epoch[idx] < cur) {
+                    epoch[idx] = cur;
+                    m.attacks[idx] = refs[i];
+                } else if (m.attacks[idx] != refs[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
+
+void init_attacks() {
+    static bool inited = false;
+    if (inited) return;
+    inited = true;
+
+    for (int s = 0; s < 64; ++s) {
+        int f = s & 7, r = s >> 3;
+        Bitboard b = 0;
+        auto add = [&](int df, int dr){ int nf=f+df, nr=r+dr; if (nf>=0&&nf<8&&nr>=0&&nr<8) b |= ONE << (nr*8+nf); };
+        add(+1,+2); add(+2,+1); add(+2,-1); add(+1,-2); add(-1,-2); add(-2,-1); add(-2,+1); add(-1,+2);
+        KNIGHT_ATTACKS[s] = b;
+
+        b = 0;
+        for (int df=-1; df<=1; ++df)
+            for (int dr=-1; dr<=1; ++dr)
+                if (df!=0 || dr!=0) add(df,dr);
+        KING_ATTACKS[s] = b;
+
+        Bitboard w=0,bk=0;
+        if (r<7) { if (f>0) w |= ONE << ((r+1)*8 + (f-1)); if (f<7) w |= ONE << ((r+1)*8 + (f+1)); }
+        if (r>0) { if (f>0) bk |= ONE << ((r-1)*8 + (f-1)); if (f<7) bk |= ONE << ((r-1)*8 + (f+1)); }
+        PAWN_ATTACKS[WHITE][s] = w;
+        PAWN_ATTACKS[BLACK][s] = bk;
+    }
+
+    const int dirsB[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
+    const int dirsR[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
+    init_magics(BISHOP_MAGICS, BISHOP_TABLE, dirsB);
+    init_magics(ROOK_MAGICS, ROOK_TABLE, dirsR);
+
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            Bitboard bb = ONE << b;
+            BETWEEN_BB[a][b] = LINE_BB[a][b] = 0;
+            if (a == b) continue;
+            if (bishop_attacks((Square)a, 0) & bb) {
+                BETWEEN_BB[a][b] = bishop_attacks((Square)a, bb) & bishop_attacks((Square)b, ONE << a);
+                LINE_BB[a][b] = (bishop_attacks((Square)a, 0) & bishop_attacks((Square)b, 0)) | (ONE << a) | bb;
+            } else if (rook_attacks((Square)a, 0) & bb) {
+                BETWEEN_BB[a][b] = rook_attacks((Square)a, bb) & rook_attacks((Square)b, ONE << a);
+                LINE_BB[a][b] = (rook_attacks((Square)a, 0) & rook_attacks((Square)b, 0)) | (ONE << a) | bb;
+            }
+        }
+    }
+}
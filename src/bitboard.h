@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.h"
+
+// BMI2 builds index the slider tables with PEXT; everything else uses
+// multiply-shift magics. Define MAS_NO_PEXT to force magics on BMI2 targets
+// (PEXT is microcoded and slow on AMD before Zen 3).
+#if defined(__BMI2__) && !defined(MAS_NO_PEXT)
+#include <immintrin.h>
+#define MAS_USE_PEXT 1
+#endif
+
+struct Magic {
+    Bitboard mask = 0;
+    Bitboard magic = 0;
+    Bitboard *attacks = nullptr;
+    int shift = 0;
+
+    unsigned index(Bitboard occ) const {
+#ifdef MAS_USE_PEXT
+        return (unsigned)_pext_u64(occ, mask);
+#else
+        return (unsigned)(((occ & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Bitboard KNIGHT_ATTACKS[64];
+extern Bitboard KING_ATTACKS[64];
+extern Bitboard PAWN_ATTACKS[2][64];
+extern Bitboard BETWEEN_BB[64][64]; // squares strictly between two aligned squares
+extern Bitboard LINE_BB[64][64];    // full line through two aligned squares, 0 otherwise
+extern Magic BISHOP_MAGICS[64];
+extern Magic ROOK_MAGICS[64];
+
+void init_attacks();
+
+inline Bitboard bishop_attacks(Square s, Bitboard occ) {
+    const Magic &m = BISHOP_MAGICS[s];
+    return m.attacks[m.index(occ)];
+}
+
+inline Bitboard rook_attacks(Square s, Bitboard occ) {
+    const Magic &m = ROOK_MAGICS[s];
+    return m.attacks[m.index(occ)];
+}
+
+inline Bitboard queen_attacks(Square s, Bitboard occ) {
+    return bishop_attacks(s, occ) | rook_attacks(s, occ);
+}
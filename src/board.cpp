@@ -1,42 +1,14 @@
 #include "board.h"
+#include "bitboard.h"
+#include "eval.h"
 #include <random>
 #include <sstream>
 #include <algorithm>
 
-static Bitboard KNIGHT_ATTACKS[64];
-static Bitboard KING_ATTACKS[64];
-static Bitboard PAWN_ATTACKS[2][64];
-
-static void init_attacks() {
-    static bool inited = false;
-    if (inited) return;
-    inited = true;
-
-    for (int s = 0; s < 64; ++s) {
-        int f = s & 7, r = s >> 3;
-        Bitboard b = 0;
-        auto add = [&](int df, int dr){ int nf=f+df, nr=r+dr; if (nf>=0&&nf<8&&nr>=0&&nr<8) b |= ONE << (nr*8+nf); };
-        add(+1,+2); add(+2,+1); add(+2,-1); add(+1,-2); add(-1,-2); add(-2,-1); add(-2,+1); add(-1,+2);
-        KNIGHT_ATTACKS[s] = b;
-
-        b = 0;
-        auto addk = [&](int df, int dr){ int nf=f+df, nr=r+dr; if (nf>=0&&nf<8&&nr>=0&&nr<8) b |= ONE << (nr*8+nf); };
-        for (int df=-1; df<=1; ++df)
-            for (int dr=-1; dr<=1; ++dr)
-                if (df!=0 || dr!=0) addk(df,dr);
-        KING_ATTACKS[s] = b;
-
-        Bitboard w=0,bk=0;
-        if (r<7) { if (f>0) w |= ONE << ((r+1)*8 + (f-1)); if (f<7) w |= ONE << ((r+1)*8 + (f+1)); }
-        if (r>0) { if (f>0) bk |= ONE << ((r-1)*8 + (f-1)); if (f<7) bk |= ONE << ((r-1)*8 + (f+1)); }
-        PAWN_ATTACKS[WHITE][s] = w;
-        PAWN_ATTACKS[BLACK][s] = bk;
-    }
-}
-
 Board::Board() {
     init_zobrist();
     init_attacks();
+    init_eval();
     set_startpos();
 }
 
@@ -58,23 +30,40 @@ void Board::clear() {
         for (int p=0;p<6;++p) pieceBB[c][p] = 0ULL;
         occBB[c] = 0ULL;
     }
+    mailbox.fill(NO_PIECE);
+    psqScore = {0, 0};
+    gamePhase = 0;
+    if (nnue::enabled()) nnue::reset(acc_);
     castlingRights = 0;
     epSquare = -1;
     halfmoveClock = 0;
+    pliesFromNull = 0;
+    keyCount = 0;
     fullmoveNumber = 1;
     zobrist = 0ULL;
+    pawnKey = 0ULL;
     sideToMove = WHITE;
 }
 
 void Board::put_piece(Color c, PieceType pt, Square s) {
     pieceBB[c][pt] |= bit(s);
     occBB[c] |= bit(s);
+    mailbox[s] = make_piece(c, pt);
+    psqScore[c] += PSQ_TABLE[c][pt][s];
+    gamePhase += PHASE_INC[pt];
+    if (pt == PAWN) pawnKey ^= zkeys_.psq[c][PAWN][s];
+    if (nnue::enabled()) nnue::add_piece(acc_, c, pt, s);
     zobrist ^= zkeys_.psq[c][pt][s];
 }
 
 void Board::remove_piece(Color c, PieceType pt, Square s) {
     pieceBB[c][pt] &= ~bit(s);
     occBB[c] &= ~bit(s);
+    mailbox[s] = NO_PIECE;
+    psqScore[c] -= PSQ_TABLE[c][pt][s];
+    gamePhase -= PHASE_INC[pt];
+    if (pt == PAWN) pawnKey ^= zkeys_.psq[c][PAWN][s];
+    if (nnue::enabled()) nnue::remove_piece(acc_, c, pt, s);
     zobrist ^= zkeys_.psq[c][pt][s];
 }
 
@@ -83,15 +72,27 @@ void Board::move_piece(Color c, PieceType pt, Square from, Square to) {
     pieceBB[c][pt] |= bit(to);
     occBB[c] ^= bit(from);
     occBB[c] |= bit(to);
+    mailbox[from] = NO_PIECE;
+    mailbox[to] = make_piece(c, pt);
+    psqScore[c] += PSQ_TABLE[c][pt][to] - PSQ_TABLE[c][pt][from];
+    if (pt == PAWN) pawnKey ^= zkeys_.psq[c][PAWN][from] ^ zkeys_.psq[c][PAWN][to];
+    if (nnue::enabled()) nnue::move_piece(acc_, c, pt, from, to);
     zobrist ^= zkeys_.psq[c][pt][from];
     zobrist ^= zkeys_.psq[c][pt][to];
 }
 
+void Board::refresh_accumulator() {
+    if (!nnue::enabled()) return;
+    nnue::reset(acc_);
+    for (int c=0;c<2;++c)
+        for (int p=0;p<6;++p) {
+            Bitboard bb = pieceBB[c][p];
+            while (bb) nnue::add_piece(acc_, (Color)c, (PieceType)p, pop_lsb_sq(bb));
+        }
+}
+
 void Board::set_startpos() {
-    clear();
-    const char *fen = "rnbrqkbn/pppppppp/8/8/8/8/PPPPPPPP/RNBRQKBN w KQkq - 0 1";
-    // Correct startpos FEN is below; above was temporary to init; we'll set via set_fen
-    set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1");
+    set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 }
 
 bool Board::set_fen(const std::string &fen) {
@@ -182,49 +183,25 @@ std::string Board::get_fen() const {
 }
 
 int Board::piece_on(Square sq, Color &cOut, PieceType &ptOut) const {
-    Bitboard m = bit(sq);
-    for (int c=0;c<2;++c)
-        for (int p=0;p<6;++p)
-            if (pieceBB[c][p] & m) { cOut = (Color)c; ptOut = (PieceType)p; return 1; }
-    return 0;
+    Piece p = mailbox[sq];
+    if (p == NO_PIECE) return 0;
+    cOut = color_of(p); ptOut = type_of(p);
+    return 1;
 }
 
 bool Board::is_square_attacked(Square s, Color by) const {
     // Pawns
-    if (PAWN_ATTACKS[by][s] & pieceBB[by][PAWN]) return true;
+    if (PAWN_ATTACKS[opposite(by)][s] & pieceBB[by][PAWN]) return true;
     // Knights
     if (KNIGHT_ATTACKS[s] & pieceBB[by][KNIGHT]) return true;
     // Kings
     if (KING_ATTACKS[s] & pieceBB[by][KING]) return true;
-    // Bishops/Queens (diagonals)
+    // Sliders
     Bitboard occAll = occ();
-    int dirsD[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
-    for (auto &d : dirsD) {
-        int f = FILE_OF(s), r = RANK_OF(s);
-        while (true) {
-            f += d[0]; r += d[1];
-            if (f<0||f>7||r<0||r>7) break;
-            Square ns = static_cast<Square>(r*8+f);
-            Bitboard m = bit(ns);
-            if (pieceBB[by][BISHOP] & m) return true;
-            if (pieceBB[by][QUEEN] & m) return true;
-            if (occAll & m) break;
-        }
-    }
-    // Rooks/Queens (orthogonals)
-    int dirsO[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
-    for (auto &d : dirsO) {
-        int f = FILE_OF(s), r = RANK_OF(s);
-        while (true) {
-            f += d[0]; r += d[1];
-            if (f<0||f>7||r<0||r>7) break;
-            Square ns = static_cast<Square>(r*8+f);
-            Bitboard m = bit(ns);
-            if (pieceBB[by][ROOK] & m) return true;
-            if (pieceBB[by][QUEEN] & m) return true;
-            if (occAll & m) break;
-        }
-    }
+    Bitboard diag = pieceBB[by][BISHOP] | pieceBB[by][QUEEN];
+    Bitboard orth = pieceBB[by][ROOK] | pieceBB[by][QUEEN];
+    if (diag && (bishop_attacks(s, occAll) & diag)) return true;
+    if (orth && (rook_attacks(s, occAll) & orth)) return true;
     return false;
 }
 
@@ -235,192 +212,321 @@ bool Board::in_check(Color c) const {
     return is_square_attacked(ks, opposite(c));
 }
 
-static inline void add_move(std::vector<Move> &out, int from, int to, int piece, int captured, int promo, uint32_t flags) {
-    out.push_back(make_move(from, to, piece, captured, promo, flags));
+static inline void add_move(MoveList &out, int from, int to, int piece, int captured, int promo, uint32_t flags) {
+    out.add(make_move(from, to, piece, captured, promo, flags));
 }
 
-static void generate_pseudo(const Board &b, std::vector<Move> &out, bool capturesOnly) {
+Bitboard Board::attackers_to(Square s, Bitboard occAll) const {
+    return (PAWN_ATTACKS[BLACK][s] & pieceBB[WHITE][PAWN])
+         | (PAWN_ATTACKS[WHITE][s] & pieceBB[BLACK][PAWN])
+         | (KNIGHT_ATTACKS[s] & (pieceBB[WHITE][KNIGHT] | pieceBB[BLACK][KNIGHT]))
+         | (KING_ATTACKS[s] & (pieceBB[WHITE][KING] | pieceBB[BLACK][KING]))
+         | (bishop_attacks(s, occAll) & (pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN]))
+         | (rook_attacks(s, occAll) & (pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN]));
+}
+
+static const int SEE_VALUE[7] = {100, 320, 330, 500, 900, 20000, 0};
+
+bool Board::see_ge(Move m, int threshold) const {
+    if (is_castle(m)) return 0 >= threshold;
+
+    Square from = (Square)from_sq(m), to = (Square)to_sq(m);
+    int promo = promo_of(m);
+    int swap = (is_capture(m) ? SEE_VALUE[captured_of(m)] : 0) - threshold;
+    if (promo) swap += SEE_VALUE[promo] - SEE_VALUE[PAWN];
+    if (swap < 0) return false;
+
+    // What the opponent wins by taking back the piece now on 'to'
+    swap = SEE_VALUE[promo ? promo : piece_of(m)] - swap;
+    if (swap <= 0) return true;
+
+    Bitboard occupied = occ() ^ bit(from) ^ bit(to);
+    if (is_enpassant(m)) occupied ^= bit(static_cast<Square>(to + (sideToMove == WHITE ? -8 : 8)));
+    Bitboard diag = pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard orth = pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard attackers = attackers_to(to, occupied) & occupied;
+    Color stm = sideToMove;
+    int res = 1;
+
+    // Alternate least-valuable recaptures; removing each capturer from the
+    // occupancy uncovers any x-ray slider behind it.
+    while (true) {
+        stm = opposite(stm);
+        attackers &= occupied;
+        Bitboard stmAttackers = attackers & occBB[stm];
+        if (!stmAttackers) break;
+        res ^= 1;
+
+        int pt = PAWN;
+        Bitboard bb = 0;
+        for (; pt <= KING; ++pt)
+            if ((bb = stmAttackers & pieceBB[stm][pt])) break;
+
+        if (pt == KING) {
+            // The king may only recapture if the square is no longer defended
+            return (attackers & ~occBB[stm]) ? res ^ 1 : res;
+        }
+        swap = SEE_VALUE[pt] - swap;
+        if (swap < res) break;
+        occupied ^= bb & -bb;
+        if (pt == PAWN || pt == BISHOP || pt == QUEEN) attackers |= bishop_attacks(to, occupied) & diag;
+        if (pt == ROOK || pt == QUEEN) attackers |= rook_attacks(to, occupied) & orth;
+    }
+    return res;
+}
+
+static inline void add_promos(MoveList &out, int from, int to, int captured, uint32_t flags) {
+    add_move(out, from, to, PAWN, captured, QUEEN, flags | MoveFlag::PROMO);
+    add_move(out, from, to, PAWN, captured, ROOK, flags | MoveFlag::PROMO);
+    add_move(out, from, to, PAWN, captured, BISHOP, flags | MoveFlag::PROMO);
+    add_move(out, from, to, PAWN, captured, KNIGHT, flags | MoveFlag::PROMO);
+}
+
+// Legal move generation. Checkers and pinned pieces are computed once; every
+// non-king move is restricted to the check-evasion mask and, for pinned
+// pieces, to the line through the king. King moves are tested against
+// attacks with the king lifted off the board, and en passant gets an explicit
+// occupancy test for the horizontal discovered-check case.
+static void generate_moves(const Board &b, MoveList &out, GenType type) {
     Color us = b.side();
     Color them = opposite(us);
     Bitboard occUs = b.color_bb(us);
     Bitboard occThem = b.color_bb(them);
     Bitboard occAll = b.occ();
+    Bitboard kingBB = b.pieces(us, KING);
+    if (!kingBB) return;
+    Square ksq = lsb(kingBB);
+
+    Bitboard themDiag = b.pieces(them, BISHOP) | b.pieces(them, QUEEN);
+    Bitboard themOrth = b.pieces(them, ROOK) | b.pieces(them, QUEEN);
+    Bitboard checkers = b.attackers_to(ksq, occAll) & occThem;
+
+    // King moves
+    Bitboard kingTargets = KING_ATTACKS[ksq] & ~occUs;
+    if (type == GEN_CAPTURES) kingTargets &= occThem;
+    else if (type == GEN_QUIETS) kingTargets &= ~occThem;
+    Bitboard occNoKing = occAll ^ kingBB;
+    while (kingTargets) {
+        Square to = pop_lsb_sq(kingTargets);
+        if (b.attackers_to(to, occNoKing) & occThem) continue;
+        if (occThem & bit(to)) add_move(out, ksq, to, KING, type_of(b.piece_at(to)), 0, MoveFlag::CAPTURE);
+        else add_move(out, ksq, to, KING, NO_PIECE_TYPE, 0, 0);
+    }
+    if (popcount(checkers) > 1) return;
+
+    Bitboard target = checkers ? (BETWEEN_BB[ksq][lsb(checkers)] | checkers) : BB_FULL;
+
+    Bitboard pinned = 0;
+    Bitboard snipers = ((bishop_attacks(ksq, 0) & themDiag) | (rook_attacks(ksq, 0) & themOrth));
+    while (snipers) {
+        Square sn = pop_lsb_sq(snipers);
+        Bitboard blockers = BETWEEN_BB[ksq][sn] & occAll;
+        if (blockers && !(blockers & (blockers - 1))) pinned |= blockers & occUs;
+    }
+    auto pin_mask = [&](Square from) { return (pinned & bit(from)) ? LINE_BB[ksq][from] : BB_FULL; };
 
     // Pawns
+    int dir = us == WHITE ? 8 : -8;
+    Bitboard rank3 = us == WHITE ? 0x0000000000FF0000ULL : 0x0000FF0000000000ULL;
+    Bitboard promoFrom = us == WHITE ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
     Bitboard pawns = b.pieces(us, PAWN);
     while (pawns) {
         Square from = pop_lsb_sq(pawns);
-        int f = FILE_OF(from), r = RANK_OF(from);
-        int dir = us == WHITE ? 1 : -1;
-        int startRank = us == WHITE ? 1 : 6;
-        int promoRank = us == WHITE ? 6 : 1;
-        // Pushes
-        if (!capturesOnly) {
-            int nr = r + dir;
-            if (nr>=0 && nr<8) {
-                Square to = static_cast<Square>(nr*8+f);
-                if (!(occAll & bit(to))) {
-                    if (r == promoRank) {
-                        add_move(out, from, to, PAWN, NO_PIECE_TYPE, QUEEN, MoveFlag::PROMO);
-                        add_move(out, from, to, PAWN, NO_PIECE_TYPE, ROOK, MoveFlag::PROMO);
-                        add_move(out, from, to, PAWN, NO_PIECE_TYPE, BISHOP, MoveFlag::PROMO);
-                        add_move(out, from, to, PAWN, NO_PIECE_TYPE, KNIGHT, MoveFlag::PROMO);
-                    } else {
-                        add_move(out, from, to, PAWN, NO_PIECE_TYPE, 0, 0);
-                        if (r == startRank) {
-                            int nr2 = r + 2*dir;
-                            Square to2 = static_cast<Square>(nr2*8+f);
-                            if (!(occAll & bit(to2))) add_move(out, from, to2, PAWN, NO_PIECE_TYPE, 0, MoveFlag::DPP);
-                        }
-                    }
+        Bitboard allowed = target & pin_mask(from);
+        bool promo = promoFrom & bit(from);
+        if (type != GEN_CAPTURES) {
+            int to = from + dir;
+            if (!(occAll & (ONE << to))) {
+                if (allowed & (ONE << to)) {
+                    if (promo) add_promos(out, from, to, NO_PIECE_TYPE, 0);
+                    else add_move(out, from, to, PAWN, NO_PIECE_TYPE, 0, 0);
                 }
+                int to2 = to + dir;
+                if ((rank3 & (ONE << to)) && !(occAll & (ONE << to2)) && (allowed & (ONE << to2)))
+                    add_move(out, from, to2, PAWN, NO_PIECE_TYPE, 0, MoveFlag::DPP);
             }
         }
-        // Captures and en passant
-        Bitboard atks = PAWN_ATTACKS[us][from] & occThem;
+        if (type == GEN_QUIETS) continue;
+        Bitboard atks = PAWN_ATTACKS[us][from] & occThem & allowed;
         while (atks) {
             Square to = pop_lsb_sq(atks);
-            Color c; PieceType pt; b.piece_on(to, c, pt);
-            if (r == promoRank) {
-                add_move(out, from, to, PAWN, pt, QUEEN, MoveFlag::CAPTURE | MoveFlag::PROMO);
-                add_move(out, from, to, PAWN, pt, ROOK, MoveFlag::CAPTURE | MoveFlag::PROMO);
-                add_move(out, from, to, PAWN, pt, BISHOP, MoveFlag::CAPTURE | MoveFlag::PROMO);
-                add_move(out, from, to, PAWN, pt, KNIGHT, MoveFlag::CAPTURE | MoveFlag::PROMO);
-            } else {
-                add_move(out, from, to, PAWN, pt, 0, MoveFlag::CAPTURE);
-            }
+            PieceType pt = type_of(b.piece_at(to));
+            if (promo) add_promos(out, from, to, pt, MoveFlag::CAPTURE);
+            else add_move(out, from, to, PAWN, pt, 0, MoveFlag::CAPTURE);
         }
-        if (b.ep_square() >= 0) {
+        if (b.ep_square() >= 0 && (PAWN_ATTACKS[us][from] & bit((Square)b.ep_square()))) {
             Square epsq = static_cast<Square>(b.ep_square());
-            Bitboard epMask = PAWN_ATTACKS[us][from] & bit(epsq);
-            if (epMask) add_move(out, from, epsq, PAWN, PAWN, 0, MoveFlag::CAPTURE | MoveFlag::ENPASS);
+            Square capSq = static_cast<Square>(epsq - dir);
+            Bitboard occAfter = (occAll ^ bit(from) ^ bit(capSq)) | bit(epsq);
+            bool exposed = (bishop_attacks(ksq, occAfter) & themDiag) || (rook_attacks(ksq, occAfter) & themOrth)
+                        || (checkers & ~bit(capSq) & ~themDiag & ~themOrth);
+            if (!exposed) add_move(out, from, epsq, PAWN, PAWN, 0, MoveFlag::CAPTURE | MoveFlag::ENPASS);
         }
     }
 
-    // Knights
-    Bitboard knights = b.pieces(us, KNIGHT);
-    while (knights) {
-        Square from = pop_lsb_sq(knights);
-        Bitboard moves = KNIGHT_ATTACKS[from] & ~occUs;
-        while (moves) {
-            Square to = pop_lsb_sq(moves);
-            int cap = (occThem & bit(to)) ? (int)NO_PIECE_TYPE : -1;
-            if (cap >= 0) {
-                Color c; PieceType pt; b.piece_on(to, c, pt);
-                add_move(out, from, to, KNIGHT, pt, 0, MoveFlag::CAPTURE);
-            } else if (!capturesOnly) {
-                add_move(out, from, to, KNIGHT, NO_PIECE_TYPE, 0, 0);
-            }
-        }
-    }
-
-    // Bishops, Rooks, Queens via rays
-    auto gen_sliders = [&](PieceType pt, const int dirs[][2], int numDirs){
+    // Knights, Bishops, Rooks, Queens via attack tables
+    Bitboard pieceTargets = (type == GEN_CAPTURES ? occThem : type == GEN_QUIETS ? ~occAll : ~occUs) & target;
+    auto gen_piece = [&](PieceType pt){
         Bitboard bb = b.pieces(us, pt);
+        if (pt == KNIGHT) bb &= ~pinned;
         while (bb) {
             Square from = pop_lsb_sq(bb);
-            int f0 = FILE_OF(from), r0 = RANK_OF(from);
-            for (int i=0;i<numDirs;++i){
-                int f=f0, r=r0;
-                while (true){
-                    f += dirs[i][0]; r += dirs[i][1];
-                    if (f<0||f>7||r<0||r>7) break;
-                    Square to = static_cast<Square>(r*8+f);
-                    Bitboard m = bit(to);
-                    if (occUs & m) break;
-                    if (occThem & m) {
-                        Color c; PieceType cap; b.piece_on(to, c, cap);
-                        add_move(out, from, to, pt, cap, 0, MoveFlag::CAPTURE);
-                        break;
-                    }
-                    if (!capturesOnly) add_move(out, from, to, pt, NO_PIECE_TYPE, 0, 0);
-                }
+            Bitboard atk = pt == KNIGHT ? KNIGHT_ATTACKS[from]
+                         : pt == BISHOP ? bishop_attacks(from, occAll)
+                         : pt == ROOK   ? rook_attacks(from, occAll)
+                                        : queen_attacks(from, occAll);
+            atk &= pieceTargets & pin_mask(from);
+            Bitboard caps = atk & occThem;
+            while (caps) {
+                Square to = pop_lsb_sq(caps);
+                add_move(out, from, to, pt, type_of(b.piece_at(to)), 0, MoveFlag::CAPTURE);
             }
+            Bitboard quiets = atk & ~occAll;
+            while (quiets) add_move(out, from, pop_lsb_sq(quiets), pt, NO_PIECE_TYPE, 0, 0);
         }
     };
-    const int dirsB[4][2]={{1,1},{1,-1},{-1,1},{-1,-1}};
-    const int dirsR[4][2]={{1,0},{-1,0},{0,1},{0,-1}};
-    gen_sliders(BISHOP, dirsB, 4);
-    gen_sliders(ROOK, dirsR, 4);
-    // Queens combine
-    Bitboard queens = b.pieces(us, QUEEN);
-    while (queens) {
-        Square from = pop_lsb_sq(queens);
-        int f0 = FILE_OF(from), r0 = RANK_OF(from);
-        for (auto d: dirsB) {
-            int f=f0, r=r0; while(true){ f+=d[0]; r+=d[1]; if(f<0||f>7||r<0||r>7) break; Square to=static_cast<Square>(r*8+f); Bitboard m=bit(to); if (occUs&m) break; if (occThem&m){ Color c; PieceType cap; b.piece_on(to,c,cap); add_move(out, from,to, QUEEN, cap, 0, MoveFlag::CAPTURE); break;} if (!capturesOnly) add_move(out, from,to, QUEEN, NO_PIECE_TYPE, 0, 0);} }
-        for (auto d: dirsR) {
-            int f=f0, r=r0; while(true){ f+=d[0]; r+=d[1]; if(f<0||f>7||r<0||r>7) break; Square to=static_cast<Square>(r*8+f); Bitboard m=bit(to); if (occUs&m) break; if (occThem&m){ Color c; PieceType cap; b.piece_on(to,c,cap); add_move(out, from,to, QUEEN, cap, 0, MoveFlag::CAPTURE); break;} if (!capturesOnly) add_move(out, from,to, QUEEN, NO_PIECE_TYPE, 0, 0);} }
+    gen_piece(KNIGHT);
+    gen_piece(BISHOP);
+    gen_piece(ROOK);
+    gen_piece(QUEEN);
+
+    // Castling
+    if (type == GEN_CAPTURES || checkers) return;
+    auto try_castle = [&](int right, Square kfrom, Square kto, Square rook, Bitboard path, Square pass) {
+        if (!(b.castling_rights() & right) || ksq != kfrom) return;
+        if (!(b.pieces(us, ROOK) & bit(rook)) || (occAll & path)) return;
+        if (b.is_square_attacked(pass, them) || b.is_square_attacked(kto, them)) return;
+        add_move(out, kfrom, kto, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
+    };
+    if (us == WHITE) {
+        try_castle(Castle::WK, E1, G1, H1, bit(F1)|bit(G1), F1);
+        try_castle(Castle::WQ, E1, C1, A1, bit(D1)|bit(C1)|bit(B1), D1);
+    } else {
+        try_castle(Castle::BK, E8, G8, H8, bit(F8)|bit(G8), F8);
+        try_castle(Castle::BQ, E8, C8, A8, bit(D8)|bit(C8)|bit(B8), D8);
     }
+}
 
-    // King moves + castling
-    Bitboard king = b.pieces(us, KING);
-    if (king) {
-        Square from = lsb(king);
-        Bitboard moves = KING_ATTACKS[from] & ~occUs;
-        while (moves) {
-            Square to = pop_lsb_sq(moves);
-            int cap = (occThem & bit(to)) ? 1 : 0;
-            if (cap) { Color c; PieceType pt; b.piece_on(to, c, pt); add_move(out, from,to, KING, pt, 0, MoveFlag::CAPTURE);} else if (!capturesOnly) add_move(out, from,to, KING, NO_PIECE_TYPE, 0, 0);
-        }
-        if (!capturesOnly) {
-            bool inCheck = b.in_check(us);
-            if (!inCheck) {
-                // Castling rights
-                if (us==WHITE) {
-                    if (b.castling_rights() & Castle::WK) {
-                        if (!(b.occ() & (bit(F1)|bit(G1))) && !b.is_square_attacked(F1, them) && !b.is_square_attacked(G1, them))
-                            add_move(out, E1, G1, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
-                    }
-                    if (b.castling_rights() & Castle::WQ) {
-                        if (!(b.occ() & (bit(D1)|bit(C1)|bit(B1))) && !b.is_square_attacked(D1, them) && !b.is_square_attacked(C1, them))
-                            add_move(out, E1, C1, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
-                    }
-                } else {
-                    if (b.castling_rights() & Castle::BK) {
-                        if (!(b.occ() & (bit(F8)|bit(G8))) && !b.is_square_attacked(F8, them) && !b.is_square_attacked(G8, them))
-                            add_move(out, E8, G8, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
-                    }
-                    if (b.castling_rights() & Castle::BQ) {
-                        if (!(b.occ() & (bit(D8)|bit(C8)|bit(B8))) && !b.is_square_attacked(D8, them) && !b.is_square_attacked(C8, them))
-                            add_move(out, E8, C8, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
-                    }
-                }
+Move Board::legal_move_from16(Move m16) const {
+    int from = from_sq(m16), to = to_sq(m16), promo = promo_of(m16);
+    Color us = sideToMove, them = opposite(us);
+    Piece pc = mailbox[from];
+    if (!m16 || from == to || pc == NO_PIECE || color_of(pc) != us || (occBB[us] & bit((Square)to))) return 0;
+
+    PieceType pt = type_of(pc);
+    Bitboard occAll = occ();
+    Piece target = mailbox[to];
+    int captured = target == NO_PIECE ? (int)NO_PIECE_TYPE : (int)type_of(target);
+    uint32_t flags = target == NO_PIECE ? 0 : MoveFlag::CAPTURE;
+    Bitboard removed = bit((Square)to);
+    Bitboard occAfter = (occAll ^ bit((Square)from)) | bit((Square)to);
+
+    if (pt == PAWN) {
+        int dir = us == WHITE ? 8 : -8;
+        bool lastRank = RANK_OF((Square)to) == (us == WHITE ? 7 : 0);
+        if (lastRank != (promo != 0) || (promo && (promo < KNIGHT || promo > QUEEN))) return 0;
+        if (lastRank) flags |= MoveFlag::PROMO;
+        if (to == from + dir) {
+            if (target != NO_PIECE) return 0;
+        } else if (to == from + 2 * dir) {
+            if (RANK_OF((Square)from) != (us == WHITE ? 1 : 6) || (occAll & (bit((Square)(from + dir)) | bit((Square)to)))) return 0;
+            flags |= MoveFlag::DPP;
+        } else if (PAWN_ATTACKS[us][from] & bit((Square)to)) {
+            if (target == NO_PIECE) {
+                if (to != epSquare) return 0;
+                captured = PAWN;
+                flags |= MoveFlag::CAPTURE | MoveFlag::ENPASS;
+                removed |= bit((Square)(to - dir));
+                occAfter ^= bit((Square)(to - dir));
             }
+        } else return 0;
+    } else {
+        if (promo) return 0;
+        if (pt == KING && (to - from == 2 || from - to == 2)) {
+            int right = to == G1 ? Castle::WK : to == C1 ? Castle::WQ : to == G8 ? Castle::BK : to == C8 ? Castle::BQ : 0;
+            Square rook = to == G1 ? H1 : to == C1 ? A1 : to == G8 ? H8 : A8;
+            Bitboard path = BETWEEN_BB[from][rook];
+            Square pass = static_cast<Square>((from + to) / 2);
+            if (!right || !(castlingRights & right) || (from != (us == WHITE ? E1 : E8)) || RANK_OF((Square)to) != RANK_OF((Square)from)) return 0;
+            if (!(pieceBB[us][ROOK] & bit(rook)) || (occAll & path) || in_check(us)) return 0;
+            if (is_square_attacked(pass, them) || is_square_attacked((Square)to, them)) return 0;
+            return ::make_move(from, to, KING, NO_PIECE_TYPE, 0, MoveFlag::CASTLE);
         }
+        Bitboard atk = pt == KNIGHT ? KNIGHT_ATTACKS[from]
+                     : pt == BISHOP ? bishop_attacks((Square)from, occAll)
+                     : pt == ROOK   ? rook_attacks((Square)from, occAll)
+                     : pt == QUEEN  ? queen_attacks((Square)from, occAll)
+                                    : KING_ATTACKS[from];
+        if (!(atk & bit((Square)to))) return 0;
     }
+
+    // Legal iff no enemy piece (other than the captured one) attacks our king
+    // once the move is played on the occupancy.
+    Square ksq = pt == KING ? (Square)to : lsb(pieceBB[us][KING]);
+    if (attackers_to(ksq, occAfter) & occBB[them] & ~removed) return 0;
+    return ::make_move(from, to, pt, captured, promo, flags);
 }
 
-void Board::generate_legal_moves(std::vector<Move> &out) const {
-    std::vector<Move> moves; moves.reserve(256);
-    generate_pseudo(*this, moves, false);
-    // Filter illegal
-    Board copy = *this;
-    StateInfo st{};
-    for (Move m : moves) {
-        if (copy.make_move(m, st)) out.push_back(m);
-        copy.unmake_move(st);
-    }
+void Board::generate_legal_moves(MoveList &out) const {
+    generate_moves(*this, out, GEN_ALL);
 }
 
-void Board::generate_captures(std::vector<Move> &out) const {
-    std::vector<Move> moves; moves.reserve(128);
-    generate_pseudo(*this, moves, true);
-    Board copy = *this;
-    StateInfo st{};
-    for (Move m : moves) {
-        if (copy.make_move(m, st)) out.push_back(m);
-        copy.unmake_move(st);
+void Board::generate_captures(MoveList &out) const {
+    generate_moves(*this, out, GEN_CAPTURES);
+}
+
+void Board::generate_quiets(MoveList &out) const {
+    generate_moves(*this, out, GEN_QUIETS);
+}
+
+static int castling_after(int rights, int from, int to) {
+    auto revoke = [&](int s){
+        if (s==A1) rights &= ~Castle::WQ;
+        if (s==H1) rights &= ~Castle::WK;
+        if (s==E1) rights &= ~(Castle::WK|Castle::WQ);
+        if (s==A8) rights &= ~Castle::BQ;
+        if (s==H8) rights &= ~Castle::BK;
+        if (s==E8) rights &= ~(Castle::BK|Castle::BQ);
+    };
+    revoke(from);
+    revoke(to);
+    return rights;
+}
+
+uint64_t Board::key_after(Move m) const {
+    int from = from_sq(m), to = to_sq(m);
+    PieceType piece = (PieceType)piece_of(m);
+    uint32_t fl = flags_of(m);
+    Color us = sideToMove, them = opposite(us);
+
+    uint64_t k = zobrist ^ zkeys_.side;
+    if (epSquare >= 0) k ^= zkeys_.epFile[FILE_OF((Square)epSquare)];
+    k ^= zkeys_.psq[us][piece][from];
+    k ^= zkeys_.psq[us][(fl & MoveFlag::PROMO) ? promo_of(m) : piece][to];
+    if (fl & MoveFlag::ENPASS) k ^= zkeys_.psq[them][PAWN][to + (us == WHITE ? -8 : 8)];
+    else if (fl & MoveFlag::CAPTURE) k ^= zkeys_.psq[them][captured_of(m)][to];
+    if (fl & MoveFlag::DPP) k ^= zkeys_.epFile[FILE_OF((Square)to)];
+    if (fl & MoveFlag::CASTLE) {
+        if (to == G1) k ^= zkeys_.psq[WHITE][ROOK][H1] ^ zkeys_.psq[WHITE][ROOK][F1];
+        else if (to == C1) k ^= zkeys_.psq[WHITE][ROOK][A1] ^ zkeys_.psq[WHITE][ROOK][D1];
+        else if (to == G8) k ^= zkeys_.psq[BLACK][ROOK][H8] ^ zkeys_.psq[BLACK][ROOK][F8];
+        else if (to == C8) k ^= zkeys_.psq[BLACK][ROOK][A8] ^ zkeys_.psq[BLACK][ROOK][D8];
     }
+    int rights = castling_after(castlingRights, from, to);
+    if (rights != castlingRights) k ^= zkeys_.castling[castlingRights] ^ zkeys_.castling[rights];
+    return k;
 }
 
-bool Board::make_move(Move m, StateInfo &st) {
+void Board::make_move(Move m, StateInfo &st) {
     st.zobrist = zobrist;
     st.castlingRights = castlingRights;
     st.epSquare = epSquare;
     st.halfmoveClock = halfmoveClock;
+    st.pliesFromNull = pliesFromNull;
     st.capturedPiece = captured_of(m);
     st.move = m;
+    keyHistory[keyCount++ & (KEY_HISTORY - 1)] = zobrist;
+    ++pliesFromNull;
 
     int from = from_sq(m);
     int to = to_sq(m);
@@ -436,9 +542,6 @@ bool Board::make_move(Move m, StateInfo &st) {
     if (epSquare >= 0) zobrist ^= zkeys_.epFile[FILE_OF((Square)epSquare)];
     epSquare = -1;
 
-    // Move piece
-    move_piece(sideToMove, piece, (Square)from, (Square)to);
-
     // Captures
     if (fl & MoveFlag::CAPTURE) {
         if (fl & MoveFlag::ENPASS) {
@@ -454,6 +557,9 @@ bool Board::make_move(Move m, StateInfo &st) {
         if (piece == PAWN) halfmoveClock = 0; else ++halfmoveClock;
     }
 
+    // Move piece (after the capture so the mailbox keeps the mover on 'to')
+    move_piece(sideToMove, piece, (Square)from, (Square)to);
+
     // Promotion
     if (fl & MoveFlag::PROMO) {
         remove_piece(sideToMove, PAWN, (Square)to);
@@ -478,36 +584,22 @@ bool Board::make_move(Move m, StateInfo &st) {
 
     // Update castling rights and hash
     zobrist ^= zkeys_.castling[castlingRights];
-    auto revoke = [&](Square s){
-        if (s==A1) castlingRights &= ~Castle::WQ;
-        if (s==H1) castlingRights &= ~Castle::WK;
-        if (s==E1) castlingRights &= ~(Castle::WK|Castle::WQ);
-        if (s==A8) castlingRights &= ~Castle::BQ;
-        if (s==H8) castlingRights &= ~Castle::BK;
-        if (s==E8) castlingRights &= ~(Castle::BK|Castle::BQ);
-    };
-    revoke((Square)from);
-    revoke((Square)to);
+    castlingRights = castling_after(castlingRights, from, to);
     zobrist ^= zkeys_.castling[castlingRights];
 
     // Update side
     sideToMove = opposite(sideToMove);
     if (sideToMove == WHITE) ++fullmoveNumber;
-
-    // legality: own king must not be in check
-    if (!in_check(opposite(sideToMove))) return true;
-    // Undo if illegal
-    unmake_move(st);
-    return false;
 }
 
 void Board::unmake_move(const StateInfo &st) {
     // Restore basics
     sideToMove = opposite(sideToMove);
-    zobrist = st.zobrist;
     castlingRights = st.castlingRights;
     epSquare = st.epSquare;
     halfmoveClock = st.halfmoveClock;
+    pliesFromNull = st.pliesFromNull;
+    --keyCount;
     if (sideToMove == BLACK) --fullmoveNumber;
 
     Move m = st.move;
@@ -541,6 +633,8 @@ void Board::unmake_move(const StateInfo &st) {
             put_piece(opposite(sideToMove), captured, (Square)to);
         }
     }
+    // piece helpers above re-hash; restore the saved key last
+    zobrist = st.zobrist;
 }
 
 void Board::make_null(StateInfo &st) {
@@ -548,8 +642,12 @@ void Board::make_null(StateInfo &st) {
     st.castlingRights = castlingRights;
     st.epSquare = epSquare;
     st.halfmoveClock = halfmoveClock;
+    st.pliesFromNull = pliesFromNull;
     st.capturedPiece = NO_PIECE_TYPE;
     st.move = 0;
+    // A null move is never part of a real repetition
+    keyHistory[keyCount++ & (KEY_HISTORY - 1)] = zobrist;
+    pliesFromNull = 0;
     // side key
     zobrist ^= zkeys_.side;
     if (epSquare >= 0) zobrist ^= zkeys_.epFile[FILE_OF((Square)epSquare)];
@@ -563,5 +661,28 @@ void Board::unmake_null(const StateInfo &st) {
     castlingRights = st.castlingRights;
     epSquare = st.epSquare;
     halfmoveClock = st.halfmoveClock;
+    pliesFromNull = st.pliesFromNull;
+    --keyCount;
+}
+
+bool Board::is_draw(int ply) const {
+    if (halfmoveClock >= 100) {
+        // Mate delivered on the hundredth ply still counts
+        if (!in_check(sideToMove)) return true;
+        MoveList ml;
+        generate_legal_moves(ml);
+        if (!ml.empty()) return true;
+    }
+
+    // Only positions since the last capture, pawn move or null move can
+    // repeat, and only those with the same side to move.
+    int n = keyCount;
+    int end = std::min({halfmoveClock, pliesFromNull, n, KEY_HISTORY});
+    int seen = 0;
+    for (int i = 4; i <= end; i += 2) {
+        if (keyHistory[(n - i) & (KEY_HISTORY - 1)] != zobrist) continue;
+        if (i < ply || ++seen == 2) return true;
+    }
+    return false;
 }
 
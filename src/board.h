@@ -1,10 +1,15 @@
 #pragma once
 
 #include "common.h"
+#include "movegen.h"
+#include "nnue.h"
 #include <array>
-#include <vector>
 #include <string>
 
+// Captures include en passant and capture-promotions; quiets are every
+// other move, including non-capture promotions and castling.
+enum GenType { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
+
 struct ZobristKeys {
     std::array<std::array<std::array<uint64_t, 64>, 6>, 2> psq;
     std::array<uint64_t, 16> castling;
@@ -30,21 +35,45 @@ public:
     int castling_rights() const { return castlingRights; }
     int ep_square() const { return epSquare; }
     uint64_t key() const { return zobrist; }
+    uint64_t key_after(Move m) const; // key make_move(m) would produce, for TT prefetch
+    uint64_t pawn_key() const { return pawnKey; }
     int halfmove() const { return halfmoveClock; }
+    Score psq(Color c) const { return psqScore[c]; } // running material + PST
+    int phase() const { return gamePhase; }
+    const nnue::Accumulator &accumulator() const { return acc_; }
+    void refresh_accumulator(); // rebuild from scratch, e.g. after loading a network
     int fullmove() const { return fullmoveNumber; }
 
+    // Fifty-move rule or repetition. 'ply' is the distance from the search
+    // root: repeating a position reached after the root is enough, while one
+    // from the game history must already have occurred twice.
+    bool is_draw(int ply) const;
+
     bool is_square_attacked(Square s, Color by) const;
     bool in_check(Color c) const;
+    Bitboard attackers_to(Square s, Bitboard occAll) const;
 
-    bool make_move(Move m, StateInfo &st);
+    // Static exchange evaluation: does m win at least 'threshold' centipawns
+    // once all captures on its destination square are played out?
+    bool see_ge(Move m, int threshold) const;
+
+    // Moves must come from generate_legal_moves/generate_captures; no
+    // legality check is done here.
+    void make_move(Move m, StateInfo &st);
     void unmake_move(const StateInfo &st);
     void make_null(StateInfo &st);
     void unmake_null(const StateInfo &st);
 
-    void generate_legal_moves(std::vector<Move> &out) const;
-    void generate_captures(std::vector<Move> &out) const;
+    void generate_legal_moves(MoveList &out) const;
+    void generate_captures(MoveList &out) const;
+    void generate_quiets(MoveList &out) const;
+
+    // Rebuilds the full move for a move16 (e.g. a TT move, killer or
+    // counter move from another position); 0 if it is not legal here.
+    Move legal_move_from16(Move m16) const;
 
     int piece_on(Square s, Color &cOut, PieceType &ptOut) const;
+    Piece piece_at(Square s) const { return mailbox[s]; }
 
     const ZobristKeys &zkeys() const { return zkeys_; }
 
@@ -53,13 +82,25 @@ private:
 
     std::array<std::array<Bitboard, 6>, 2> pieceBB{};
     std::array<Bitboard, 2> occBB{};
+    std::array<Piece, 64> mailbox{};
 
     Color sideToMove{WHITE};
     int castlingRights{0};
     int epSquare{-1};
     int halfmoveClock{0};
+    int pliesFromNull{0};
     int fullmoveNumber{1};
     uint64_t zobrist{0};
+    uint64_t pawnKey{0};
+    std::array<Score, 2> psqScore{};
+    int gamePhase{0};
+    nnue::Accumulator acc_; // only maintained while a network is loaded
+    // Keys of earlier positions as a ring: a repetition can only reach back
+    // past the last irreversible move, at most 100 plies before the fifty
+    // move rule ends the game, plus the search path (MAX_PLY = 128).
+    static constexpr int KEY_HISTORY = 256;
+    std::array<uint64_t, KEY_HISTORY> keyHistory{};
+    int keyCount = 0; // keys pushed so far; the ring holds the last KEY_HISTORY
 
     ZobristKeys zkeys_{};
 
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "board.h"
+#include <ostream>
+#include <string>
+
+// Polyglot opening book. The .bin file is an array of 16-byte big-endian
+// entries sorted by key:
+//   uint64 key, uint16 move, uint16 weight, uint32 learn
+// It is mmap'ed and binary-searched in place; probing never touches the
+// search TT. Polyglot keys use the format's own random table, so they are
+// computed separately from Board::key().
+namespace book {
+
+uint64_t polyglot_key(const Board &b);
+
+// Maps the book file; returns false and keeps the previous book on error.
+// An empty path unloads the book.
+bool load(const std::string &path, std::string &error);
+bool loaded();
+
+// A legal book move for b picked at random in proportion to its weight,
+// or 0 if the position is not in the book.
+Move probe(const Board &b);
+
+struct MakeBookOptions {
+    int maxPly = 30;     // positions deeper into a game are not recorded
+    int memoryMb = 256;  // entry buffer; beyond it sorted runs go to outPath.runN
+};
+
+// Streams a PGN file (games, weighted 2/1/0 by result for the side that
+// played the move) or an EPD file (one position per line with a "bm"
+// opcode, weight 1 per best move) into a Polyglot book at outPath.
+// EPD is chosen by the .epd extension. Memory use is bounded by memoryMb
+// whatever the input size: larger inputs are sorted in runs on disk next
+// to outPath and merged. Progress goes to 'out'.
+bool make_book(const std::string &inPath, const std::string &outPath, const MakeBookOptions &opts,
+               std::ostream &out, std::string &error);
+
+} // namespace book
@@ -12,6 +12,13 @@ enum Color : int { WHITE = 0, BLACK = 1, NO_COLOR = 2 };
 
 enum PieceType : int { PAWN = 0, KNIGHT = 1, BISHOP = 2, ROOK = 3, QUEEN = 4, KING = 5, NO_PIECE_TYPE = 6 };
 
+// Colored piece: color * 6 + piece type
+enum Piece : int { NO_PIECE = 12 };
+
+constexpr Piece make_piece(Color c, PieceType pt) { return static_cast<Piece>(c * 6 + pt); }
+constexpr PieceType type_of(Piece p) { return static_cast<PieceType>(p % 6); }
+constexpr Color color_of(Piece p) { return static_cast<Color>(p / 6); }
+
 enum Square : int {
     A1, B1, C1, D1, E1, F1, G1, H1,
     A2, B2, C2, D2, E2, F2, G2, H2,
@@ -54,6 +61,14 @@ inline Square pop_lsb_sq(Bitboard &b) {
 
 inline Color opposite(Color c) { return c == WHITE ? BLACK : WHITE; }
 
+// Packed middlegame/endgame evaluation pair: eg in the upper 16 bits, mg in
+// the lower 16, so both halves are updated with one add.
+using Score = int32_t;
+
+constexpr Score make_score(int mg, int eg) { return static_cast<Score>(static_cast<uint32_t>(eg) << 16) + mg; }
+inline int mg_value(Score s) { return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(s))); }
+inline int eg_value(Score s) { return static_cast<int16_t>(static_cast<uint16_t>((static_cast<uint32_t>(s) + 0x8000) >> 16)); }
+
 // Move encoding: 32-bit
 // bits 0..5  : from (0..63)
 // bits 6..11  : to (0..63)
@@ -91,6 +106,9 @@ inline int captured_of(Move m) { return (m >> 15) & 0x7; }
 inline int piece_of(Move m) { return (m >> 19) & 0x7; }
 inline uint32_t flags_of(Move m) { return m & (MoveFlag::CAPTURE | MoveFlag::ENPASS | MoveFlag::CASTLE | MoveFlag::DPP | MoveFlag::PROMO); }
 
+// from/to/promo bits only; enough to identify a move within one position
+inline Move move16(Move m) { return m & 0x7FFF; }
+
 inline bool is_capture(Move m) { return flags_of(m) & MoveFlag::CAPTURE; }
 inline bool is_promo(Move m) { return flags_of(m) & MoveFlag::PROMO; }
 inline bool is_enpassant(Move m) { return flags_of(m) & MoveFlag::ENPASS; }
@@ -101,6 +119,7 @@ struct StateInfo {
     int castlingRights;
     int epSquare; // -1 if none
     int halfmoveClock;
+    int pliesFromNull;
     int capturedPiece; // PieceType or NO_PIECE_TYPE
     Move move;
 };
@@ -117,6 +136,16 @@ inline std::string square_to_string(Square s) {
     return std::string{file} + std::string{rank};
 }
 
+// Long algebraic notation as used by UCI, e.g. "e2e4" or "e7e8q"
+inline std::string move_to_string(Move m) {
+    std::string s = square_to_string(static_cast<Square>(from_sq(m))) + square_to_string(static_cast<Square>(to_sq(m)));
+    if (is_promo(m)) {
+        int p = promo_of(m);
+        s += (p==QUEEN?'q': p==ROOK?'r': p==BISHOP?'b':'n');
+    }
+    return s;
+}
+
 inline int char_to_file(char c) { return c - 'a'; }
 inline int char_to_rank(char c) { return c - '1'; }
 
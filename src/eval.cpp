@@ -1,6 +1,21 @@
 #include "eval.h"
+#include "pawns.h"
+#include "bitbase.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-static const int PIECE_VAL[6] = {100, 320, 330, 500, 900, 20000};
+// Tables are laid out as seen from White: first row is rank 8. Kings carry
+// no material value: both sides always have one, and the per-side sums must
+// fit the 16-bit halves of a packed Score.
+static const int PIECE_VAL_MG[6] = {100, 320, 330, 500, 900, 0};
+static const int PIECE_VAL_EG[6] = {120, 300, 320, 530, 950, 0};
+
+static constexpr Score BISHOP_PAIR = make_score(30, 50);
+
+// Non-pawn material weights for the game phase; 24 = full middlegame.
+const int PHASE_INC[6] = {0, 1, 1, 2, 4, 0};
 
 static const int PST_PAWN[64] = {
       0,  0,  0,  0,  0,  0,  0,  0,
@@ -68,39 +83,167 @@ static const int PST_KING_MG[64] = {
       2,  3,  1,  0,  0,  1,  3,  2
 };
 
+static const int PST_PAWN_EG[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+     90, 90, 90, 90, 90, 90, 90, 90,
+     50, 50, 45, 40, 40, 45, 50, 50,
+     25, 25, 20, 20, 20, 20, 25, 25,
+     10, 10, 10, 10, 10, 10, 10, 10,
+      4,  4,  4,  4,  4,  4,  4,  4,
+      0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0
+};
+
+static const int PST_KNIGHT_EG[64] = {
+    -40,-25,-15,-10,-10,-15,-25,-40,
+    -25,-10,  0,  5,  5,  0,-10,-25,
+    -15,  0, 10, 15, 15, 10,  0,-15,
+    -10,  5, 15, 20, 20, 15,  5,-10,
+    -10,  5, 15, 20, 20, 15,  5,-10,
+    -15,  0, 10, 15, 15, 10,  0,-15,
+    -25,-10,  0,  5,  5,  0,-10,-25,
+    -40,-25,-15,-10,-10,-15,-25,-40
+};
+
+static const int PST_BISHOP_EG[64] = {
+    -15,-10, -8, -5, -5, -8,-10,-15,
+    -10, -3,  0,  2,  2,  0, -3,-10,
+     -8,  0,  5,  8,  8,  5,  0, -8,
+     -5,  2,  8, 10, 10,  8,  2, -5,
+     -5,  2,  8, 10, 10,  8,  2, -5,
+     -8,  0,  5,  8,  8,  5,  0, -8,
+    -10, -3,  0,  2,  2,  0, -3,-10,
+    -15,-10, -8, -5, -5, -8,-10,-15
+};
+
+static const int PST_ROOK_EG[64] = {
+      8,  8,  8,  8,  8,  8,  8,  8,
+     10, 10, 10, 10, 10, 10, 10, 10,
+      4,  4,  4,  4,  4,  4,  4,  4,
+      2,  2,  2,  2,  2,  2,  2,  2,
+      0,  0,  0,  0,  0,  0,  0,  0,
+     -2, -2, -2, -2, -2, -2, -2, -2,
+     -4, -4, -4, -4, -4, -4, -4, -4,
+     -6, -4, -2,  0,  0, -2, -4, -6
+};
+
+static const int PST_QUEEN_EG[64] = {
+    -20,-12, -8, -5, -5, -8,-12,-20,
+    -12, -4,  0,  4,  4,  0, -4,-12,
+     -8,  0,  8, 12, 12,  8,  0, -8,
+     -5,  4, 12, 16, 16, 12,  4, -5,
+     -5,  4, 12, 16, 16, 12,  4, -5,
+     -8,  0,  8, 12, 12,  8,  0, -8,
+    -12, -4,  0,  4,  4,  0, -4,-12,
+    -20,-12, -8, -5, -5, -8,-12,-20
+};
+
+static const int PST_KING_EG[64] = {
+    -50,-35,-25,-20,-20,-25,-35,-50,
+    -30,-15, -5,  0,  0, -5,-15,-30,
+    -25, -5, 10, 15, 15, 10, -5,-25,
+    -20,  0, 15, 25, 25, 15,  0,-20,
+    -20,  0, 15, 25, 25, 15,  0,-20,
+    -25, -5, 10, 15, 15, 10, -5,-25,
+    -30,-15, -5,  0,  0, -5,-15,-30,
+    -50,-35,-25,-20,-20,-25,-35,-50
+};
+
 static inline int pst_mirror(int idx) {
     int f = idx & 7, r = idx >> 3;
     int mr = 7 - r;
     return mr*8 + f;
 }
 
-int evaluate(const Board &b) {
-    // Side-to-move perspective
-    int score = 0;
-    for (int c=0;c<2;++c) {
-        int sign = (c==b.side()) ? 1 : -1;
-        for (int p=0;p<6;++p) {
-            Bitboard bb = b.pieces((Color)c, (PieceType)p);
-            while (bb) {
-                Square s = pop_lsb_sq(bb);
-                int idx = (c==WHITE) ? s : pst_mirror(s);
-                switch (p) {
-                    case PAWN:   score += sign * (PIECE_VAL[p] + PST_PAWN[idx]); break;
-                    case KNIGHT: score += sign * (PIECE_VAL[p] + PST_KNIGHT[idx]); break;
-                    case BISHOP: score += sign * (PIECE_VAL[p] + PST_BISHOP[idx]); break;
-                    case ROOK:   score += sign * (PIECE_VAL[p] + PST_ROOK[idx]); break;
-                    case QUEEN:  score += sign * (PIECE_VAL[p] + PST_QUEEN[idx]); break;
-                    case KING:   score += sign * (PIECE_VAL[p] + PST_KING_MG[idx]); break;
-                    default: break;
-                }
+Score PSQ_TABLE[2][6][64];
+
+void init_eval() {
+    static bool inited = false;
+    if (inited) return;
+    inited = true;
+
+    static const int *PST_MG[6] = {PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING_MG};
+    static const int *PST_EG[6] = {PST_PAWN_EG, PST_KNIGHT_EG, PST_BISHOP_EG, PST_ROOK_EG, PST_QUEEN_EG, PST_KING_EG};
+    for (int c=0;c<2;++c)
+        for (int p=0;p<6;++p)
+            for (int s=0;s<64;++s) {
+                // Tables read top-down from rank 8, so White flips the rank
+                int idx = (c==WHITE) ? pst_mirror(s) : s;
+                PSQ_TABLE[c][p][s] = make_score(PIECE_VAL_MG[p] + PST_MG[p][idx],
+                                                PIECE_VAL_EG[p] + PST_EG[p][idx]);
             }
-        }
+}
+
+#ifdef MAS_DEBUG_EVAL
+// Not an assert: the check has to fire in the Release builds that search
+// deep enough to reach the broken position.
+static void debug_check(bool cond, const char *what, const Board &b) {
+    if (cond) return;
+    std::fprintf(stderr, "debug eval: %s mismatch in %s\n", what, b.get_fen().c_str());
+    std::abort();
+}
+
+// Full recompute of the packed material + PST sum and the game phase,
+// checked against Board's running values.
+static Score psq_full(const Board &b, Color c) {
+    Score score = 0;
+    for (int p=0;p<6;++p) {
+        Bitboard bb = b.pieces(c, (PieceType)p);
+        while (bb) score += PSQ_TABLE[c][p][pop_lsb_sq(bb)];
+    }
+    return score;
+}
+
+static int phase_full(const Board &b) {
+    int phase = 0;
+    for (int c=0;c<2;++c)
+        for (int p=0;p<6;++p) phase += PHASE_INC[p] * popcount(b.pieces((Color)c, (PieceType)p));
+    return phase;
+}
+#endif
+
+int evaluate(const Board &b, PawnTable *pawns) {
+    // Elementary endings are scored from the bitbases
+    int known;
+    if (popcount(b.occ()) <= 4 && bitbase::evaluate(b, known)) return known;
+
+    if (nnue::enabled()) {
+#ifdef MAS_DEBUG_EVAL
+        Board fresh = b;
+        fresh.refresh_accumulator();
+        debug_check(!memcmp(&fresh.accumulator(), &b.accumulator(), sizeof(nnue::Accumulator)), "accumulator", b);
+#endif
+        return nnue::evaluate(b.accumulator(), b.side());
     }
+
+    // Side-to-move perspective
+    Color us = b.side(), them = opposite(us);
+#ifdef MAS_DEBUG_EVAL
+    debug_check(b.psq(WHITE) == psq_full(b, WHITE) && b.psq(BLACK) == psq_full(b, BLACK), "psq", b);
+    debug_check(b.phase() == phase_full(b), "phase", b);
+    if (pawns) debug_check(pawns->probe(b).score == evaluate_pawns(b).score, "pawn hash", b);
+#endif
+    Score score = b.psq(us) - b.psq(them);
     // Bishop pair bonus
     for (int c=0;c<2;++c) {
         if (popcount(b.pieces((Color)c, BISHOP)) >= 2)
-            score += (c==b.side() ? 35 : -35);
+            score += (c==us ? BISHOP_PAIR : -BISHOP_PAIR);
     }
-    return score;
+    // Pawn structure, plus a bonus for passed pawns whose stop square is free
+    PawnEntry local;
+    const PawnEntry &pe = pawns ? pawns->probe(b) : (local = evaluate_pawns(b));
+    score += us == WHITE ? pe.score : -pe.score;
+    Bitboard occ = b.occ();
+    for (int c=0;c<2;++c) {
+        Bitboard passed = pe.passed[c];
+        while (passed) {
+            Square sq = pop_lsb_sq(passed);
+            int relRank = c == WHITE ? RANK_OF(sq) : 7 - RANK_OF(sq);
+            Square stop = static_cast<Square>(sq + (c == WHITE ? 8 : -8));
+            if (!(occ & bit(stop))) score += (c==us ? 1 : -1) * make_score(0, 5 * relRank);
+        }
+    }
+    // Interpolate between middlegame and endgame by remaining material
+    int phase = std::min(b.phase(), PHASE_MAX);
+    return (mg_value(score) * phase + eg_value(score) * (PHASE_MAX - phase)) / PHASE_MAX;
 }
-
@@ -2,5 +2,17 @@
 
 #include "board.h"
 
-int evaluate(const Board &b);
+class PawnTable;
+
+// Material + piece-square value of a piece as a packed middlegame/endgame
+// Score, from its own side's point of view. Board sums these incrementally
+// per side together with the game phase.
+extern Score PSQ_TABLE[2][6][64];
+extern const int PHASE_INC[6];
+constexpr int PHASE_MAX = 24;
+
+void init_eval();
+// Side-to-move score. Pawn-structure terms come from the given table, or
+// are computed directly when none is passed.
+int evaluate(const Board &b, PawnTable *pawns = nullptr);
 
@@ -1,8 +1,145 @@
 #include "uci.h"
+#include "perft.h"
+#include "bench.h"
+#include "book.h"
+#include "bitbase.h"
+#include "analyse.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
 
-int main() {
+static int usage(const char *text) {
+    std::cerr << "usage: maschess " << text << std::endl;
+    return 1;
+}
+
+// The whole argument must be a number: std::stoi throws on "abc", which
+// aborts, and accepts "12abc".
+static bool parse_int(const char *s, int &out) {
+    char *end;
+    errno = 0;
+    long long v = std::strtoll(s, &end, 10);
+    if (end == s || *end || errno || v < INT_MIN || v > INT_MAX) return false;
+    out = (int)v;
+    return true;
+}
+
+static bool parse_u64(const char *s, uint64_t &out) {
+    char *end;
+    errno = 0;
+    unsigned long long v = std::strtoull(s, &end, 10);
+    if (end == s || *end || errno || strchr(s, '-')) return false;
+    out = v;
+    return true;
+}
+
+static const char PERFT_USAGE[] = "perft <depth> [--threads N] [--hash MB] [--fen F] | perft suite [--threads N] [--hash MB]";
+
+// maschess perft <depth> [--threads N] [--hash MB] [--fen "<fen>"]
+// maschess perft suite [--threads N] [--hash MB]
+static int run_perft(int argc, char **argv) {
+    PerftOptions opts;
+    bool suite = false;
+    std::string fen;
+    for (int i = 2; i < argc; ++i) {
+        bool ok = true;
+        if (!strcmp(argv[i], "suite")) suite = true;
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) ok = parse_int(argv[++i], opts.threads);
+        else if (!strcmp(argv[i], "--hash") && i + 1 < argc) ok = parse_int(argv[++i], opts.hashMb);
+        else if (!strcmp(argv[i], "--fen") && i + 1 < argc) fen = argv[++i];
+        else ok = parse_int(argv[i], opts.depth);
+        if (!ok) return usage(PERFT_USAGE);
+    }
+    if (suite) return perft_suite(opts, std::cout) ? 0 : 1;
+    Board b;
+    if (!fen.empty() && !b.set_fen(fen)) {
+        std::cerr << "invalid fen: " << fen << std::endl;
+        return 1;
+    }
+    perft_divide(b, opts, std::cout);
+    return 0;
+}
+
+// maschess bench [depth] [hash MB] [threads]
+static int run_bench(int argc, char **argv) {
+    BenchOptions opts;
+    if ((argc > 2 && !parse_int(argv[2], opts.depth)) || (argc > 3 && !parse_int(argv[3], opts.hashMb))
+        || (argc > 4 && !parse_int(argv[4], opts.threads)))
+        return usage("bench [depth] [hash MB] [threads]");
+    bench(opts, std::cout);
+    return 0;
+}
+
+// maschess makebook <input.pgn|input.epd> <output.bin> [--plies N] [--memory MB]
+static int run_makebook(int argc, char **argv) {
+    const char *text = "makebook <input.pgn|input.epd> <output.bin> [--plies N] [--memory MB]";
+    if (argc < 4) return usage(text);
+    book::MakeBookOptions opts;
+    for (int i = 4; i < argc; ++i) {
+        bool ok = true;
+        if (!strcmp(argv[i], "--plies") && i + 1 < argc) ok = parse_int(argv[++i], opts.maxPly);
+        else if (!strcmp(argv[i], "--memory") && i + 1 < argc) ok = parse_int(argv[++i], opts.memoryMb);
+        if (!ok) return usage(text);
+    }
+    std::string err;
+    if (!book::make_book(argv[2], argv[3], opts, std::cout, err)) {
+        std::cerr << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// maschess bitbases <cache.bin> [--threads N]
+static int run_bitbases(int argc, char **argv) {
+    const char *text = "bitbases <cache.bin> [--threads N]";
+    if (argc < 3) return usage(text);
+    int threads = (int)std::thread::hardware_concurrency();
+    for (int i = 3; i < argc; ++i)
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc && !parse_int(argv[++i], threads)) return usage(text);
+    std::string err;
+    if (!bitbase::init(std::max(threads, 1), argv[2], err)) {
+        std::cerr << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// maschess analyse <file.epd> [--depth N | --nodes N | --movetime MS] [--jobs J] [--hash MB] [--json]
+static int run_analyse(int argc, char **argv) {
+    const char *text = "analyse <file.epd> [--depth N | --nodes N | --movetime MS] [--jobs J] [--hash MB] [--json]";
+    if (argc < 3) return usage(text);
+    AnalyseOptions opts;
+    for (int i = 3; i < argc; ++i) {
+        bool ok = true;
+        if (!strcmp(argv[i], "--depth") && i + 1 < argc) ok = parse_int(argv[++i], opts.limits.depth);
+        else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) ok = parse_u64(argv[++i], opts.limits.nodes);
+        else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) ok = parse_int(argv[++i], opts.limits.movetime);
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) ok = parse_int(argv[++i], opts.jobs);
+        else if (!strcmp(argv[i], "--hash") && i + 1 < argc) ok = parse_int(argv[++i], opts.hashMb);
+        else if (!strcmp(argv[i], "--json")) opts.json = true;
+        if (!ok) return usage(text);
+    }
+    if (!opts.limits.depth && !opts.limits.nodes && !opts.limits.movetime) opts.limits.depth = 10;
+    std::string err;
+    if (!analyse(argv[2], opts, std::cout, std::cerr, err)) {
+        std::cerr << err << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "perft")) return run_perft(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "bench")) return run_bench(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "makebook")) return run_makebook(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "bitbases")) return run_bitbases(argc, argv);
+    if (argc > 1 && !strcmp(argv[1], "analyse")) return run_analyse(argc, argv);
     UCI uci;
     uci.loop();
     return 0;
 }
-
@@ -1,13 +1,30 @@
 #pragma once
 
-#include "board.h"
-#include <vector>
+#include "common.h"
 
-struct MoveList {
-    std::vector<Move> moves;
-    void clear() { moves.clear(); }
-    void add(Move m) { moves.push_back(m); }
-    size_t size() const { return moves.size(); }
-    Move operator[](size_t i) const { return moves[i]; }
+struct ScoredMove {
+    Move move;
+    int score;
+    operator Move() const { return move; }
 };
 
+// Fixed-capacity move list living on the stack; 256 covers the maximum
+// number of legal moves in any reachable position (218).
+struct MoveList {
+    static constexpr int CAPACITY = 256;
+
+    ScoredMove moves[CAPACITY];
+    int count = 0;
+
+    void clear() { count = 0; }
+    void add(Move m) { moves[count++] = {m, 0}; }
+    size_t size() const { return (size_t)count; }
+    bool empty() const { return count == 0; }
+    Move operator[](size_t i) const { return moves[i].move; }
+    int &score(size_t i) { return moves[i].score; }
+
+    ScoredMove *begin() { return moves; }
+    ScoredMove *end() { return moves + count; }
+    const ScoredMove *begin() const { return moves; }
+    const ScoredMove *end() const { return moves + count; }
+};
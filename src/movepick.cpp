@@ -0,0 +1,147 @@
+#include "movepick.h"
+#include <utility>
+
+static const int PIECE_ORDER_VAL[7] = {100, 320, 330, 500, 900, 20000, 0};
+
+// Offset separating captures that win or trade material from losing ones.
+static constexpr int GOOD_CAPTURE_BASE = 1 << 20;
+
+int mvv_lva(Move m) {
+    return PIECE_ORDER_VAL[captured_of(m)] * 10 - PIECE_ORDER_VAL[piece_of(m)];
+}
+
+MovePicker::MovePicker(const Board &b, Move ttMove, Move killer1, Move killer2, Move counter, const int (&history)[64][64],
+                       const PieceToHistory *cont1, const PieceToHistory *cont2)
+    : b(b), history(history), cont1(cont1), cont2(cont2), ttMove(ttMove), counter(counter), stage(MAIN_TT) {
+    killers[0] = killer1;
+    killers[1] = killer2;
+}
+
+MovePicker::MovePicker(const Board &b) : b(b), stage(QS_CAPTURE_INIT) {}
+
+void MovePicker::score_captures() {
+    for (size_t i = 0; i < captures.size(); ++i) {
+        Move m = captures[i];
+        // Captures that lose material by SEE are deferred until after the quiets
+        captures.score(i) = mvv_lva(m) + (b.see_ge(m, 0) ? GOOD_CAPTURE_BASE : 0);
+    }
+}
+
+// Selection step: swaps the best remaining move with score >= minScore to
+// position cur and returns its index, or -1 if none qualifies.
+int MovePicker::pick_best(MoveList &list, int minScore) {
+    if (cur >= list.count) return -1;
+    int best = cur;
+    for (int i = cur + 1; i < list.count; ++i)
+        if (list.moves[i].score > list.moves[best].score) best = i;
+    if (list.moves[best].score < minScore) return -1;
+    std::swap(list.moves[cur], list.moves[best]);
+    return cur++;
+}
+
+bool MovePicker::is_special(Move m) const {
+    Move m16 = move16(m);
+    return m16 == ttMove || m16 == move16(killers[0]) || m16 == move16(killers[1]) || m16 == move16(counter);
+}
+
+Move MovePicker::next() {
+    switch (stage) {
+    case MAIN_TT:
+        ++stage;
+        if (ttMove) {
+            Move m = b.legal_move_from16(ttMove);
+            if (m) return m;
+            ttMove = 0;
+        }
+        [[fallthrough]];
+
+    case CAPTURE_INIT:
+        b.generate_captures(captures);
+        score_captures();
+        cur = 0;
+        ++stage;
+        [[fallthrough]];
+
+    case GOOD_CAPTURE:
+        for (int i; (i = pick_best(captures, GOOD_CAPTURE_BASE)) >= 0; ) {
+            if (move16(captures[i]) != ttMove) return captures[i];
+        }
+        ++stage;
+        [[fallthrough]];
+
+    case KILLER1:
+    case KILLER2:
+        while (stage <= KILLER2) {
+            Move k = killers[stage - KILLER1];
+            ++stage;
+            if (!k || move16(k) == ttMove) continue;
+            Move m = b.legal_move_from16(move16(k));
+            if (m && !is_capture(m)) return m;
+        }
+        [[fallthrough]];
+
+    case COUNTER:
+        ++stage;
+        if (counter && move16(counter) != ttMove && move16(counter) != move16(killers[0]) && move16(counter) != move16(killers[1])) {
+            Move m = b.legal_move_from16(move16(counter));
+            if (m && !is_capture(m)) return m;
+        }
+        [[fallthrough]];
+
+    case QUIET_INIT: {
+        b.generate_quiets(quiets);
+        for (size_t i = 0; i < quiets.size(); ++i) {
+            Move m = quiets[i];
+            Piece pc = make_piece(b.side(), (PieceType)piece_of(m));
+            int to = to_sq(m);
+            quiets.score(i) = history[from_sq(m)][to]
+                            + (cont1 ? (*cont1)[pc][to] : 0)
+                            + (cont2 ? (*cont2)[pc][to] : 0);
+        }
+        // insertion sort, best first
+        for (int i = 1; i < quiets.count; ++i) {
+            ScoredMove sm = quiets.moves[i];
+            int j = i - 1;
+            while (j >= 0 && quiets.moves[j].score < sm.score) { quiets.moves[j + 1] = quiets.moves[j]; --j; }
+            quiets.moves[j + 1] = sm;
+        }
+        ++stage;
+        qcur = 0;
+    }
+        [[fallthrough]];
+
+    case QUIET:
+        while (qcur < quiets.count) {
+            Move m = quiets[qcur++];
+            if (!is_special(m)) return m;
+        }
+        ++stage;
+        [[fallthrough]];
+
+    case BAD_CAPTURE:
+        for (int i; (i = pick_best(captures, -GOOD_CAPTURE_BASE)) >= 0; ) {
+            if (move16(captures[i]) != ttMove) return captures[i];
+        }
+        stage = DONE;
+        return 0;
+
+    case QS_CAPTURE_INIT:
+        b.generate_captures(captures);
+        for (size_t i = 0; i < captures.size(); ++i) captures.score(i) = mvv_lva(captures[i]);
+        cur = 0;
+        ++stage;
+        [[fallthrough]];
+
+    case QS_CAPTURE:
+        // SEE is checked lazily so a cutoff on an early capture saves the
+        // exchange evaluation of the rest; losing captures are never searched.
+        for (int i; (i = pick_best(captures, -GOOD_CAPTURE_BASE)) >= 0; ) {
+            if (b.see_ge(captures[i], 0)) return captures[i];
+        }
+        stage = DONE;
+        return 0;
+
+    default:
+        return 0;
+    }
+}
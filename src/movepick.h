@@ -0,0 +1,56 @@
+#pragma once
+
+#include "board.h"
+#include <cstdint>
+
+// Quiet-move statistics are kept within +-HISTORY_MAX by gravity updates.
+constexpr int HISTORY_MAX = 16384;
+
+// Continuation history: how well a [piece][to] move did as a reply to an
+// earlier [piece][to] move on the search path.
+using PieceToHistory = int16_t[12][64];
+
+// Staged move ordering. Each stage generates and scores its moves only when
+// the search asks for them, so a node that cuts off on the TT move or a
+// good capture never pays for generating or sorting the quiets.
+//
+// Main search: TT move, good captures (SEE >= 0, picked by selection),
+// killers, counter move, quiets sorted by butterfly plus continuation
+// history, losing captures.
+// Quiescence: captures only, by MVV-LVA, skipping those that lose by SEE.
+class MovePicker {
+public:
+    MovePicker(const Board &b, Move ttMove, Move killer1, Move killer2, Move counter, const int (&history)[64][64],
+               const PieceToHistory *cont1, const PieceToHistory *cont2);
+    explicit MovePicker(const Board &b);
+
+    // Next legal move, or 0 when exhausted.
+    Move next();
+
+private:
+    enum Stage {
+        MAIN_TT, CAPTURE_INIT, GOOD_CAPTURE, KILLER1, KILLER2, COUNTER, QUIET_INIT, QUIET, BAD_CAPTURE,
+        QS_CAPTURE_INIT, QS_CAPTURE,
+        DONE
+    };
+
+    const Board &b;
+    const int (*history)[64] = nullptr;
+    const PieceToHistory *cont1 = nullptr; // reply to the previous move
+    const PieceToHistory *cont2 = nullptr; // follow-up to our own last move
+    Move ttMove = 0;
+    Move killers[2] = {0, 0};
+    Move counter = 0;
+    int stage;
+
+    MoveList captures;
+    MoveList quiets;
+    int cur = 0;   // next unpicked capture
+    int qcur = 0;  // next quiet
+
+    void score_captures();
+    int pick_best(MoveList &list, int minScore);
+    bool is_special(Move m) const;
+};
+
+int mvv_lva(Move m);
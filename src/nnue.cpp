@@ -0,0 +1,208 @@
+#include "nnue.h"
+#include "bitbase.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nnue {
+
+namespace {
+
+constexpr size_t HEADER_BYTES = 64;
+constexpr size_t FILE_BYTES = HEADER_BYTES
+                            + sizeof(int16_t) * INPUTS * HIDDEN
+                            + sizeof(int16_t) * HIDDEN
+                            + sizeof(int16_t) * 2 * HIDDEN
+                            + sizeof(int32_t);
+
+struct Network {
+    void *mapping = nullptr;
+    size_t size = 0;
+    const int16_t *ftWeights = nullptr;
+    const int16_t *ftBiases = nullptr;
+    const int16_t *outWeights = nullptr;
+    int32_t outBias = 0;
+};
+
+Network net;
+
+void unmap(Network &n) {
+#if defined(__unix__) || defined(__APPLE__)
+    if (n.mapping) munmap(n.mapping, n.size);
+#endif
+    n = Network{};
+}
+
+inline int feature(Color perspective, Color c, PieceType pt, Square s) {
+    // Each side sees itself as White on ranks 1..8
+    int sq = perspective == WHITE ? (int)s : ((int)s ^ 56);
+    return (c == perspective ? 0 : 384) + pt * 64 + sq;
+}
+
+inline void add_row(int16_t *acc, const int16_t *w) {
+#if defined(__AVX2__)
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256((const __m256i *)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        _mm256_store_si256((__m256i *)(acc + i), _mm256_add_epi16(a, b));
+    }
+#elif defined(__SSE2__)
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128((const __m128i *)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(w + i));
+        _mm_store_si128((__m128i *)(acc + i), _mm_add_epi16(a, b));
+    }
+#else
+    for (int i = 0; i < HIDDEN; ++i) acc[i] = (int16_t)(acc[i] + w[i]);
+#endif
+}
+
+inline void sub_row(int16_t *acc, const int16_t *w) {
+#if defined(__AVX2__)
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256((const __m256i *)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        _mm256_store_si256((__m256i *)(acc + i), _mm256_sub_epi16(a, b));
+    }
+#elif defined(__SSE2__)
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128((const __m128i *)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(w + i));
+        _mm_store_si128((__m128i *)(acc + i), _mm_sub_epi16(a, b));
+    }
+#else
+    for (int i = 0; i < HIDDEN; ++i) acc[i] = (int16_t)(acc[i] - w[i]);
+#endif
+}
+
+// sum_i clamp(acc[i], 0, QA) * w[i], as int16 x int16 -> int32 dot products
+inline int32_t crelu_dot(const int16_t *acc, const int16_t *w) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256((const __m256i *)(acc + i));
+        a = _mm256_min_epi16(_mm256_max_epi16(a, zero), qa);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(QA);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128((const __m128i *)(acc + i));
+        a = _mm_min_epi16(_mm_max_epi16(a, zero), qa);
+        __m128i b = _mm_loadu_si128((const __m128i *)(w + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, b));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < HIDDEN; ++i) {
+        int v = acc[i] < 0 ? 0 : (acc[i] > QA ? QA : acc[i]);
+        sum += v * w[i];
+    }
+    return sum;
+#endif
+}
+
+} // namespace
+
+bool netLoaded = false;
+
+bool load(const std::string &path, std::string &error) {
+    if (path.empty() || path == "<empty>") {
+        netLoaded = false;
+        unmap(net);
+        return true;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) { error = "cannot open " + path; return false; }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != FILE_BYTES) {
+        close(fd);
+        error = "unexpected network size for " + path;
+        return false;
+    }
+    void *map = mmap(nullptr, FILE_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { error = "cannot mmap " + path; return false; }
+
+    const char *base = static_cast<const char *>(map);
+    uint32_t hidden = 0;
+    std::memcpy(&hidden, base + 8, sizeof(hidden));
+    if (std::memcmp(base, "MASNNUE1", 8) != 0 || hidden != (uint32_t)HIDDEN) {
+        munmap(map, FILE_BYTES);
+        error = "bad network header in " + path;
+        return false;
+    }
+
+    unmap(net);
+    net.mapping = map;
+    net.size = FILE_BYTES;
+    const char *p = base + HEADER_BYTES;
+    net.ftWeights = reinterpret_cast<const int16_t *>(p);
+    p += sizeof(int16_t) * INPUTS * HIDDEN;
+    net.ftBiases = reinterpret_cast<const int16_t *>(p);
+    p += sizeof(int16_t) * HIDDEN;
+    net.outWeights = reinterpret_cast<const int16_t *>(p);
+    p += sizeof(int16_t) * 2 * HIDDEN;
+    std::memcpy(&net.outBias, p, sizeof(net.outBias));
+    netLoaded = true;
+    return true;
+#else
+    error = "network loading needs mmap";
+    return false;
+#endif
+}
+
+void reset(Accumulator &acc) {
+    std::memcpy(acc.v[WHITE], net.ftBiases, sizeof(acc.v[WHITE]));
+    std::memcpy(acc.v[BLACK], net.ftBiases, sizeof(acc.v[BLACK]));
+}
+
+void add_piece(Accumulator &acc, Color c, PieceType pt, Square s) {
+    add_row(acc.v[WHITE], net.ftWeights + feature(WHITE, c, pt, s) * HIDDEN);
+    add_row(acc.v[BLACK], net.ftWeights + feature(BLACK, c, pt, s) * HIDDEN);
+}
+
+void remove_piece(Accumulator &acc, Color c, PieceType pt, Square s) {
+    sub_row(acc.v[WHITE], net.ftWeights + feature(WHITE, c, pt, s) * HIDDEN);
+    sub_row(acc.v[BLACK], net.ftWeights + feature(BLACK, c, pt, s) * HIDDEN);
+}
+
+void move_piece(Accumulator &acc, Color c, PieceType pt, Square from, Square to) {
+    for (int persp = 0; persp < 2; ++persp) {
+        sub_row(acc.v[persp], net.ftWeights + feature((Color)persp, c, pt, from) * HIDDEN);
+        add_row(acc.v[persp], net.ftWeights + feature((Color)persp, c, pt, to) * HIDDEN);
+    }
+}
+
+int evaluate(const Accumulator &acc, Color stm) {
+    int64_t out = (int64_t)crelu_dot(acc.v[stm], net.outWeights)
+                + crelu_dot(acc.v[opposite(stm)], net.outWeights + HIDDEN)
+                + net.outBias;
+    // An untrained or foreign net can produce anything; keep it below the
+    // bitbase and mate scores so those still rank above any network eval
+    int64_t limit = bitbase::KNOWN_WIN - 1;
+    return (int)std::clamp<int64_t>(out * SCALE / (QA * QB), -limit, limit);
+}
+
+} // namespace nnue
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+#include <string>
+
+// Optional NNUE evaluator: 768 perspective-relative (color, piece, square)
+// inputs -> 2 x NNUE_HIDDEN int16 accumulator -> clipped ReLU -> 1 output.
+//
+// Network file layout (little endian, mmap'ed and used in place):
+//   64-byte header: "MASNNUE1", uint32 hidden size, zero padding
+//   int16 feature weights [768][NNUE_HIDDEN]
+//   int16 feature biases  [NNUE_HIDDEN]
+//   int16 output weights  [2 * NNUE_HIDDEN] (side to move first)
+//   int32 output bias
+namespace nnue {
+
+constexpr int INPUTS = 768;
+constexpr int HIDDEN = 256;
+constexpr int QA = 255;    // accumulator clip / quantisation
+constexpr int QB = 64;     // output weight quantisation
+constexpr int SCALE = 400; // network output to centipawns
+
+struct Accumulator {
+    alignas(64) int16_t v[2][HIDDEN];
+};
+
+// Maps the network file; returns false and keeps the previous state on error.
+// An empty path unloads the network and falls back to the handcrafted eval.
+bool load(const std::string &path, std::string &error);
+
+extern bool netLoaded;
+inline bool enabled() { return netLoaded; }
+
+void reset(Accumulator &acc); // biases only, i.e. an empty board
+void add_piece(Accumulator &acc, Color c, PieceType pt, Square s);
+void remove_piece(Accumulator &acc, Color c, PieceType pt, Square s);
+void move_piece(Accumulator &acc, Color c, PieceType pt, Square from, Square to);
+int evaluate(const Accumulator &acc, Color stm); // within +-(bitbase::KNOWN_WIN - 1)
+
+} // namespace nnue
@@ -0,0 +1,65 @@
+#include "pawns.h"
+#include "bitboard.h"
+
+static constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+
+static constexpr Score DOUBLED  = make_score(-10, -20);
+static constexpr Score ISOLATED = make_score(-12, -15);
+static constexpr Score BACKWARD = make_score(-8, -10);
+static const Score PASSED[8] = {
+    make_score(0, 0), make_score(5, 10), make_score(10, 20), make_score(15, 35),
+    make_score(25, 60), make_score(45, 100), make_score(70, 150), make_score(0, 0)
+};
+
+static inline Bitboard file_bb(int f) { return FILE_A_BB << f; }
+
+static inline Bitboard adjacent_files(int f) {
+    return (f > 0 ? file_bb(f - 1) : 0) | (f < 7 ? file_bb(f + 1) : 0);
+}
+
+// Squares strictly in front of rank r from c's point of view, all files
+static inline Bitboard forward_ranks(Color c, int r) {
+    return c == WHITE ? (r < 7 ? (BB_FULL << ((r + 1) * 8)) : 0)
+                      : (r > 0 ? (BB_FULL >> ((8 - r) * 8)) : 0);
+}
+
+PawnEntry evaluate_pawns(const Board &b) {
+    PawnEntry e;
+    e.key = b.pawn_key();
+    for (int c = 0; c < 2; ++c) {
+        Color us = (Color)c, them = opposite(us);
+        Bitboard ours = b.pieces(us, PAWN), theirs = b.pieces(them, PAWN);
+        Score s = 0;
+        Bitboard bb = ours;
+        while (bb) {
+            Square sq = pop_lsb_sq(bb);
+            int f = FILE_OF(sq), r = RANK_OF(sq);
+            int relRank = us == WHITE ? r : 7 - r;
+            Bitboard front = forward_ranks(us, r);
+
+            if (ours & file_bb(f) & front) s += DOUBLED;
+
+            Bitboard neighbours = ours & adjacent_files(f);
+            if (!neighbours) s += ISOLATED;
+            else if (!(neighbours & ~front)) {
+                // No friendly pawn level with or behind on an adjacent file,
+                // and the stop square is covered by an enemy pawn
+                Square stop = static_cast<Square>(sq + (us == WHITE ? 8 : -8));
+                if (PAWN_ATTACKS[us][stop] & theirs) s += BACKWARD;
+            }
+
+            if (!(theirs & front & (file_bb(f) | adjacent_files(f))) && !(ours & file_bb(f) & front)) {
+                e.passed[us] |= bit(sq);
+                s += PASSED[relRank];
+            }
+        }
+        e.score += us == WHITE ? s : -s;
+    }
+    return e;
+}
+
+const PawnEntry &PawnTable::probe(const Board &b) {
+    PawnEntry &e = entries[b.pawn_key() & (SIZE - 1)];
+    if (e.key != b.pawn_key()) e = evaluate_pawns(b);
+    return e;
+}
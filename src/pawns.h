@@ -0,0 +1,27 @@
+#pragma once
+
+#include "board.h"
+#include <vector>
+
+// Cached pawn-structure evaluation, keyed by Board::pawn_key().
+struct PawnEntry {
+    uint64_t key = 0;
+    Score score = 0;            // White's point of view
+    Bitboard passed[2] = {0, 0};
+};
+
+// Per-thread table; a miss recomputes and overwrites the slot.
+class PawnTable {
+public:
+    static constexpr size_t SIZE = 16384; // entries, power of two
+
+    PawnTable() : entries(SIZE) {}
+
+    const PawnEntry &probe(const Board &b);
+
+private:
+    std::vector<PawnEntry> entries;
+};
+
+// Pawn-structure terms for one position, bypassing any cache.
+PawnEntry evaluate_pawns(const Board &b);
@@ -0,0 +1,180 @@
+#include "perft.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Lockless subtree-count cache. Each slot stores (count << 8 | depth) and
+// key ^ data, so a torn write from another thread fails verification.
+class PerftTable {
+public:
+    explicit PerftTable(int mb) {
+        size_t n = 1;
+        while (n * 2 * sizeof(Slot) <= (size_t)mb * 1024 * 1024) n <<= 1;
+        slots = std::vector<Slot>(n);
+        mask = n - 1;
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t &count) const {
+        const Slot &s = slots[key & mask];
+        uint64_t data = s.data.load(std::memory_order_relaxed);
+        uint64_t check = s.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || (int)(data & 0xFF) != depth) return false;
+        count = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t count) {
+        Slot &s = slots[key & mask];
+        uint64_t data = (count << 8) | (uint64_t)depth;
+        s.data.store(data, std::memory_order_relaxed);
+        s.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    std::vector<Slot> slots;
+    size_t mask = 0;
+};
+
+uint64_t perft_hashed(Board &b, int depth, PerftTable &table) {
+    MoveList moves;
+    b.generate_legal_moves(moves);
+    if (depth <= 1) return moves.size();
+    uint64_t n = 0;
+    if (table.probe(b.key(), depth, n)) return n;
+    for (Move m : moves) {
+        StateInfo st{};
+        b.make_move(m, st);
+        n += perft_hashed(b, depth - 1, table);
+        b.unmake_move(st);
+    }
+    table.store(b.key(), depth, n);
+    return n;
+}
+
+struct SuiteEntry {
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+};
+
+const SuiteEntry SUITE[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+    {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+    {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+    {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+    {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+    {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+    {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+    {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+    {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},
+    {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+    {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+    {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+    {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+    {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+};
+
+uint64_t count_root_moves(const Board &b, const MoveList &moves, const PerftOptions &opts,
+                          std::vector<uint64_t> &counts) {
+    counts.assign(moves.size(), 0);
+    if (opts.depth <= 1) {
+        for (auto &c : counts) c = 1;
+        return moves.size();
+    }
+    std::unique_ptr<PerftTable> table;
+    if (opts.hashMb > 0) table.reset(new PerftTable(opts.hashMb));
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        Board local = b;
+        for (size_t i; (i = next.fetch_add(1)) < moves.size(); ) {
+            StateInfo st{};
+            local.make_move(moves[i], st);
+            counts[i] = table ? perft_hashed(local, opts.depth - 1, *table) : perft(local, opts.depth - 1);
+            local.unmake_move(st);
+        }
+    };
+    int nthreads = std::max(1, std::min(opts.threads, (int)moves.size()));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < nthreads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    return total;
+}
+
+} // namespace
+
+uint64_t perft(Board &b, int depth) {
+    MoveList moves;
+    b.generate_legal_moves(moves);
+    if (depth <= 1) return moves.size();
+    uint64_t n = 0;
+    for (Move m : moves) {
+        StateInfo st{};
+        b.make_move(m, st);
+        n += perft(b, depth - 1);
+        b.unmake_move(st);
+    }
+    return n;
+}
+
+uint64_t perft_divide(const Board &b, const PerftOptions &opts, std::ostream &out) {
+    auto start = std::chrono::steady_clock::now();
+    MoveList moves;
+    b.generate_legal_moves(moves);
+    std::vector<uint64_t> counts;
+    uint64_t total = count_root_moves(b, moves, opts, counts);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < moves.size(); ++i)
+        out << move_to_string(moves[i]) << ": " << counts[i] << "\n";
+    out << "\nNodes: " << total << "\n";
+    out << "Time: " << ms << " ms\n";
+    out << "NPS: " << (uint64_t)(total * 1000 / (ms > 0 ? ms : 1)) << std::endl;
+    return total;
+}
+
+bool perft_suite(const PerftOptions &opts, std::ostream &out) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t totalNodes = 0;
+    int failures = 0;
+    for (const SuiteEntry &e : SUITE) {
+        Board b;
+        b.set_fen(e.fen);
+        PerftOptions o = opts;
+        o.depth = e.depth;
+        MoveList moves;
+        b.generate_legal_moves(moves);
+        std::vector<uint64_t> counts;
+        uint64_t n = count_root_moves(b, moves, o, counts);
+        totalNodes += n;
+        bool ok = n == e.nodes;
+        if (!ok) ++failures;
+        out << (ok ? "ok   " : "FAIL ") << e.fen << " depth " << e.depth
+            << " nodes " << n << " expected " << e.nodes << "\n";
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    out << "\n" << failures << " failures\n";
+    out << "Nodes: " << totalNodes << "\n";
+    out << "Time: " << ms << " ms\n";
+    out << "NPS: " << (uint64_t)(totalNodes * 1000 / (ms > 0 ? ms : 1)) << std::endl;
+    return failures == 0;
+}
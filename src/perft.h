@@ -0,0 +1,18 @@
+#pragma once
+
+#include "board.h"
+#include <ostream>
+
+struct PerftOptions {
+    int depth = 1;
+    int threads = 1;   // root moves are spread over this many workers
+    int hashMb = 0;    // 0 disables the subtree-count cache
+};
+
+uint64_t perft(Board &b, int depth);
+
+// Prints one line per root move, then the total node count, time and NPS.
+uint64_t perft_divide(const Board &b, const PerftOptions &opts, std::ostream &out);
+
+// Runs the built-in position suite with known node counts; true if all match.
+bool perft_suite(const PerftOptions &opts, std::ostream &out);
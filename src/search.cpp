@@ -1,149 +1,250 @@
 #include "search.h"
 #include "eval.h"
+#include "bitbase.h"
+#include "movepick.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
 
 Searcher::Searcher() {
     tt.resize_mb(64);
+    set_threads(1);
 }
 
-void Searcher::set_tt_mb(int mb) { tt.resize_mb((size_t)mb); }
-void Searcher::new_game() { tt.clear(); }
+// Zeroing the TT is bound by memory bandwidth, not by the search threads:
+// use every core even with Threads=1 or when Hash arrives before Threads.
+static int clear_threads(size_t workers) {
+    return std::max((int)workers, (int)std::thread::hardware_concurrency());
+}
+
+void Searcher::set_tt_mb(int mb) { tt.resize_mb((size_t)mb, clear_threads(workers.size())); }
+void Searcher::new_game() {
+    tt.clear(clear_threads(workers.size()));
+    for (auto &w : workers) w->clear_history();
+}
+
+void Searcher::new_position() {
+    tt.new_position();
+    for (auto &w : workers) w->clear_history();
+}
+
+void Searcher::set_threads(int n) {
+    n = std::max(1, n);
+    workers.clear();
+    for (int i=0;i<n;++i) workers.emplace_back(new SearchWorker(*this, i));
+}
+
+SearchStats Searcher::stats() const {
+    SearchStats total;
+    for (auto &w : workers) total.merge(w->stats);
+    return total;
+}
+
+uint64_t Searcher::node_count() const {
+    uint64_t n = 0;
+    for (auto &w : workers) n += w->node_count();
+    return n;
+}
 
 void Searcher::update_time(const Board &b, const SearchLimits &limits) {
     startTime = std::chrono::steady_clock::now();
+    nodeLimit = limits.nodes;
+    timeManaged = false;
+    softLimitMs = hardLimitMs = 0; // unlimited
     if (limits.movetime > 0) {
-        timeLimitMs = limits.movetime;
+        softLimitMs = hardLimitMs = limits.movetime;
         return;
     }
     int remain = b.side() == WHITE ? limits.wtime : limits.btime;
     int inc = b.side() == WHITE ? limits.winc : limits.binc;
-    if (remain > 0) {
-        // Allocate a small slice of available time + a portion of increment
-        int alloc = std::max(10, remain / 30) + (inc / 2);
-        timeLimitMs = alloc;
-    } else timeLimitMs = 0; // unlimited
+    if (remain <= 0) return;
+
+    // Keep a little back for move overhead, spread the rest over the moves
+    // to go (or a fixed horizon in sudden death) and spend most of the
+    // increment. The hard limit allows overrunning the slice on unstable
+    // iterations without ever risking the clock.
+    const int overhead = 30;
+    int avail = std::max(1, remain - overhead);
+    int mtg = limits.movestogo > 0 ? std::min(limits.movestogo, 40) : 30;
+    hardLimitMs = std::max(1, std::min(avail * 4 / 5, (avail / mtg + inc * 3 / 4) * 5));
+    softLimitMs = std::max(1, std::min(hardLimitMs, avail / mtg + inc * 3 / 4));
+    timeManaged = true;
 }
 
-bool Searcher::time_up() const {
-    if (timeLimitMs <= 0) return false;
+int Searcher::elapsed_ms() const {
     auto now = std::chrono::steady_clock::now();
-    int elapsed = (int)std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
-    return elapsed >= timeLimitMs;
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
 }
 
-int Searcher::mvv_lva(Move m, const Board &b) const {
-    int victim = captured_of(m);
-    int attacker = piece_of(m);
-    static const int val[7] = {100, 320, 330, 500, 900, 20000, 0};
-    return val[victim] * 10 - val[attacker];
+bool Searcher::hard_time_up() const {
+    if (hardLimitMs <= 0 || pondering.load(std::memory_order_relaxed)) return false;
+    return elapsed_ms() >= hardLimitMs;
 }
 
-void Searcher::order_moves(Board &b, std::vector<Move> &moves, Move ttMove, Move parentMove, int ply) {
-    std::stable_sort(moves.begin(), moves.end(), [&](Move a, Move c){
-        if (a == ttMove) return true;
-        if (c == ttMove) return false;
-        bool capA = is_capture(a), capC = is_capture(c);
-        if (capA != capC) return capA; // captures first
-        if (capA) return mvv_lva(a, b) > mvv_lva(c, b);
-        int stm = b.side();
-        int ha = history[stm][from_sq(a)][to_sq(a)];
-        int hc = history[stm][from_sq(c)][to_sq(c)];
-        if (ha != hc) return ha > hc;
-        if (a == killerMoves[0][ply]) return true;
-        if (c == killerMoves[0][ply]) return false;
-        if (a == killerMoves[1][ply]) return true;
-        if (c == killerMoves[1][ply]) return false;
-        return false;
-    });
+bool Searcher::soft_time_up(int scalePercent) const {
+    if (softLimitMs <= 0 || pondering.load(std::memory_order_relaxed)) return false;
+    int limit = timeManaged ? std::min(hardLimitMs, softLimitMs * scalePercent / 100) : softLimitMs;
+    return elapsed_ms() >= limit;
 }
 
-int Searcher::qsearch(Board &b, int alpha, int beta, int ply) {
-    if (time_up()) stopFlag = true;
-    if (stopFlag) return 0;
-    nodes++;
+// Main thread only. With one thread the node limit is checked before every
+// node against this worker's own counter, so node-limited searches stop at
+// exactly the same point each run. Summing the helpers' counters touches
+// a cache line per thread, so with helpers the limit is polled with the
+// clock every TIME_CHECK_NODES nodes and may be overshot slightly.
+void SearchWorker::check_limits() {
+    bool poll = (node_count() & (TIME_CHECK_NODES - 1)) == 0;
+    if (owner.nodeLimit) {
+        uint64_t n = owner.thread_count() == 1 ? node_count() : poll ? owner.node_count() : 0;
+        if (n >= owner.nodeLimit) { owner.stopFlag = true; return; }
+    }
+    if (poll && owner.hard_time_up()) owner.stopFlag = true;
+}
 
-    int stand = evaluate(b);
+int SearchWorker::qsearch(Board &b, int alpha, int beta, int ply) {
+    pvLength[ply] = ply;
+    if (id == 0) check_limits();
+    if (owner.stopFlag.load(std::memory_order_relaxed)) return 0;
+    if (ply >= MAX_PLY - 1) return evaluate(b, &pawnTable);
+    count_node();
+    selDepth = std::max(selDepth, ply + 1);
+    stats.add(ST_QS_NODE, 0, ply);
+
+    int stand = evaluate(b, &pawnTable);
     if (stand >= beta) return stand;
     if (stand > alpha) alpha = stand;
 
-    std::vector<Move> moves; moves.reserve(64);
-    b.generate_captures(moves);
-    order_moves(b, moves, 0, 0, ply);
-
-    for (size_t i=0;i<moves.size();++i) {
+    MovePicker mp(b);
+    for (Move m; (m = mp.next()); ) {
         StateInfo st{};
-        if (!b.make_move(moves[i], st)) continue;
+        b.make_move(m, st);
         int score = -qsearch(b, -beta, -alpha, ply+1);
         b.unmake_move(st);
         if (score >= beta) return score;
-        if (score > alpha) alpha = score;
+        if (score > alpha) {
+            alpha = score;
+            update_pv(ply, m);
+        }
     }
     return alpha;
 }
 
-int Searcher::search_impl(Board &b, int depth, int alpha, int beta, int ply, bool cutNode, Move parentMove) {
+int SearchWorker::search_impl(Board &b, int depth, int alpha, int beta, int ply, bool cutNode, Move parentMove) {
     int originalAlpha = alpha;
     int originalBeta = beta;
-    if (time_up()) stopFlag = true;
-    if (stopFlag) return 0;
+    pvLength[ply] = ply;
+    if (id == 0) check_limits();
+    if (owner.stopFlag.load(std::memory_order_relaxed)) return 0;
+    // Draw by rule takes precedence over any TT score for this position
+    if (ply > 0 && b.is_draw(ply)) return 0;
     bool inCheck = b.in_check(b.side());
+
+    // Bitbase endings. Draws are exact. Wins are cut off where the search
+    // converts into the ending; searches that start inside it only get the
+    // bitbase score from evaluate(), so they keep looking for the mate.
+    if (ply > 0 && popcount(b.occ()) <= 4) {
+        int known;
+        if (bitbase::evaluate(b, known) && (known == 0 || bitbaseWins)) {
+            stats.add(ST_BITBASE_HIT, depth, ply);
+            if (known < 0 && inCheck) {
+                MoveList legal;
+                b.generate_legal_moves(legal);
+                if (legal.empty()) return -MATE + ply;
+            }
+            return known;
+        }
+    }
     if (depth <= 0) return qsearch(b, alpha, beta, ply);
+    if (ply >= MAX_PLY - 1) return evaluate(b, &pawnTable);
 
-    nodes++;
+    count_node();
+    selDepth = std::max(selDepth, ply + 1);
 
     // Mate distance pruning
-    const int MATE = 32000;
     alpha = std::max(alpha, -MATE + ply);
     beta  = std::min(beta,  MATE - ply - 1);
     if (alpha >= beta) return alpha;
 
-    // TT probe
+    // TT probe (no cutoffs at the root, which must produce a move)
     TTEntry te{};
     Move ttMove = 0;
-    if (tt.probe(b.key(), te) && te.depth >= depth) {
-        int tts = score_from_tt(te.score, ply);
-        if (te.flag == TT_EXACT) return tts;
-        else if (te.flag == TT_ALPHA && tts <= alpha) return alpha;
-        else if (te.flag == TT_BETA && tts >= beta) return beta;
+    bool ttHit = owner.tt.probe(b.key(), te);
+    stats.add(ST_TT_PROBE, depth, ply);
+    if (ttHit) {
+        stats.add(ST_TT_HIT, depth, ply);
         ttMove = te.bestMove;
+        if (te.depth >= depth && ply > 0) {
+            int tts = score_from_tt(te.score, ply);
+            if (te.flag == TT_EXACT) return tts;
+            else if (te.flag == TT_ALPHA && tts <= alpha) return alpha;
+            else if (te.flag == TT_BETA && tts >= beta) return beta;
+        }
     }
 
-    // Static evaluation for pruning
-    int staticEval = evaluate(b);
+    // Static evaluation for pruning (cached in the TT entry)
+    int staticEval = ttHit ? te.eval : evaluate(b, &pawnTable);
 
     // Null-move pruning (disable in check and shallow depths)
     if (!inCheck && depth >= 3 && staticEval >= beta) {
         StateInfo st{};
+        stats.add(ST_NULL_TRY, depth, ply);
         b.make_null(st);
+        pathMoves[ply] = 0;
         int R = 2 + (depth > 6);
         int score = -search_impl(b, depth - 1 - R, -beta, -beta + 1, ply + 1, true, 0);
         b.unmake_null(st);
-        if (score >= beta) return score;
+        if (score >= beta) {
+            stats.add(ST_NULL_CUTOFF, depth, ply);
+            return score;
+        }
     }
 
-    std::vector<Move> moves; moves.reserve(256);
-    b.generate_legal_moves(moves);
-    if (moves.empty()) {
-        if (inCheck) return -MATE + ply; // mate
-        return 0; // stalemate
+    // Ordering context from the last two moves on the path
+    Color us = b.side();
+    Move prev2 = ply >= 2 ? pathMoves[ply - 2] : 0;
+    PieceToHistory *cont1 = nullptr, *cont2 = nullptr;
+    Move counter = 0;
+    if (parentMove) {
+        int pc = make_piece(opposite(us), (PieceType)piece_of(parentMove));
+        cont1 = &contHistory[pc][to_sq(parentMove)];
+        counter = counterMoves[pc][to_sq(parentMove)];
     }
+    if (prev2) cont2 = &contHistory[make_piece(us, (PieceType)piece_of(prev2))][to_sq(prev2)];
 
-    order_moves(b, moves, ttMove, parentMove, ply);
+    MovePicker mp(b, ttMove, (Move)killerMoves[0][ply], (Move)killerMoves[1][ply], counter, history[us], cont1, cont2);
 
     int bestScore = -INF;
     Move bestMove = 0;
     int legalCount = 0;
+    Move quietsTried[64];
+    int quietCount = 0;
+
+    for (Move m; (m = mp.next()); ) {
+        // SEE pruning: near the leaves, skip captures that lose more material
+        // than the remaining depth could plausibly win back
+        if (ply > 0 && !inCheck && legalCount > 0 && depth <= 4 && is_capture(m)
+            && !b.see_ge(m, -100 * depth)) {
+            ++legalCount;
+            continue;
+        }
 
-    for (size_t i=0;i<moves.size(); ++i) {
         StateInfo st{};
-        if (!b.make_move(moves[i], st)) continue;
+        owner.tt.prefetch(b.key_after(m));
+        b.make_move(m, st);
+        pathMoves[ply] = m;
         ++legalCount;
 
+        // Root move progress, only once a search has run long enough for
+        // a GUI to care
+        if (ply == 0 && id == 0 && owner.infoSink && owner.elapsed_ms() >= 3000)
+            owner.infoSink("info depth " + std::to_string(depth) + " currmove " + move_to_string(m)
+                           + " currmovenumber " + std::to_string(legalCount));
+
         int newDepth = depth - 1;
         int score;
 
-        bool isCapture = is_capture(moves[i]);
+        bool isCapture = is_capture(m);
         bool isCheck = b.in_check(b.side());
         bool quiet = !isCapture && !isCheck;
 
@@ -151,6 +252,7 @@ int Searcher::search_impl(Board &b, int depth, int alpha, int beta, int ply, boo
         if (!inCheck && quiet && depth <= 2) {
             int margin = 100 * depth;
             if (staticEval + margin <= alpha) {
+                stats.add(ST_FUTILITY_PRUNE, depth, ply);
                 b.unmake_move(st);
                 continue;
             }
@@ -158,19 +260,20 @@ int Searcher::search_impl(Board &b, int depth, int alpha, int beta, int ply, boo
 
         if (legalCount > 1 && quiet && depth >= 3) {
             // LMR
-            int R = 1 + (int)(i >= 4) + (cutNode ? 1 : 0);
-            score = -search_impl(b, newDepth - R, -alpha-1, -alpha, ply+1, true, moves[i]);
+            int R = 1 + (int)(legalCount > 4) + (cutNode ? 1 : 0);
+            score = -search_impl(b, newDepth - R, -alpha-1, -alpha, ply+1, true, m);
             if (score > alpha) {
-                score = -search_impl(b, newDepth, -alpha-1, -alpha, ply+1, true, moves[i]);
+                stats.add(ST_LMR_RESEARCH, depth, ply);
+                score = -search_impl(b, newDepth, -alpha-1, -alpha, ply+1, true, m);
                 if (score > alpha && score < beta) {
-                    score = -search_impl(b, newDepth, -beta, -alpha, ply+1, false, moves[i]);
+                    score = -search_impl(b, newDepth, -beta, -alpha, ply+1, false, m);
                 }
             }
         } else {
             // PVS
-            score = -search_impl(b, newDepth, -alpha-1, -alpha, ply+1, true, moves[i]);
+            score = -search_impl(b, newDepth, -alpha-1, -alpha, ply+1, true, m);
             if (score > alpha && score < beta) {
-                score = -search_impl(b, newDepth, -beta, -alpha, ply+1, false, moves[i]);
+                score = -search_impl(b, newDepth, -beta, -alpha, ply+1, false, m);
             }
         }
 
@@ -178,35 +281,41 @@ int Searcher::search_impl(Board &b, int depth, int alpha, int beta, int ply, boo
 
         if (score > bestScore) {
             bestScore = score;
-            bestMove = moves[i];
-            if (ply == 0) {
-                // Capture PV at root by simple re-search not needed; will report later
-            }
+            bestMove = m;
+            if (ply == 0) rootBest = m;
         }
         if (score > alpha) {
             alpha = score;
-            // update history/killers for quiets
-            if (quiet) {
-                if (killerMoves[0][ply] != (int)moves[i]) {
-                    killerMoves[1][ply] = killerMoves[0][ply];
-                    killerMoves[0][ply] = (int)moves[i];
-                }
-                history[piece_of(moves[i])&1][from_sq(moves[i])][to_sq(moves[i])] += depth * depth;
-            }
+            update_pv(ply, m);
         }
         if (alpha >= beta) {
-            // beta cutoff
-            if (quiet) {
-                if (killerMoves[0][ply] != (int)moves[i]) {
+            stats.add(ST_CUTOFF, depth, ply);
+            if (legalCount == 1) stats.add(ST_FIRST_MOVE_CUTOFF, depth, ply);
+            // beta cutoff: reward the refutation, penalise quiets tried before it
+            if (!is_capture(m) && !promo_of(m)) {
+                if (killerMoves[0][ply] != (int)m) {
                     killerMoves[1][ply] = killerMoves[0][ply];
-                    killerMoves[0][ply] = (int)moves[i];
+                    killerMoves[0][ply] = (int)m;
                 }
-                history[piece_of(moves[i])&1][from_sq(moves[i])][to_sq(moves[i])] += depth * depth;
+                if (parentMove)
+                    counterMoves[make_piece(opposite(us), (PieceType)piece_of(parentMove))][to_sq(parentMove)] = m;
+                int bonus = std::min(16 * depth * depth + 64 * depth, 1600);
+                update_quiet_stats(us, m, bonus, cont1, cont2);
+                for (int i = 0; i < quietCount; ++i)
+                    update_quiet_stats(us, quietsTried[i], -bonus, cont1, cont2);
             }
             break;
         }
+        if (!is_capture(m) && !promo_of(m) && quietCount < 64) quietsTried[quietCount++] = m;
     }
 
+    if (!legalCount) {
+        if (inCheck) return -MATE + ply; // mate
+        return 0; // stalemate
+    }
+    // Every move was pruned: fail low rather than storing -INF
+    if (bestScore == -INF) bestScore = alpha;
+
     // store TT (use original window)
     uint8_t flag;
     if (bestScore <= originalAlpha) {
@@ -217,55 +326,170 @@ int Searcher::search_impl(Board &b, int depth, int alpha, int beta, int ply, boo
         flag = TT_EXACT;
     }
     int stt = score_to_tt(bestScore, ply);
-    tt.store(b.key(), depth, stt, flag, bestMove);
+    owner.tt.store(b.key(), depth, stt, staticEval, flag, bestMove);
     return bestScore;
 }
 
-SearchResult Searcher::search(Board &b, const SearchLimits &limits) {
-    stopFlag = false;
+// Helper threads skip some iterations so they spread over neighbouring
+// depths instead of all searching the same tree.
+static const int SKIP_SIZE[20]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+void SearchWorker::reset() {
     nodes = 0;
+    stats.clear();
+    selDepth = 0;
+    rootPvLength = 0;
+    completedDepth = 0;
+    bestScore = -INF;
+    bestMove = rootBest = 0;
     memset(killerMoves, 0, sizeof(killerMoves));
+}
+
+void SearchWorker::clear_history() {
     memset(history, 0, sizeof(history));
-    update_time(b, limits);
+    memset(counterMoves, 0, sizeof(counterMoves));
+    memset(contHistory, 0, sizeof(contHistory));
+}
 
-    // Root moves
-    rootMoves.clear();
-    b.generate_legal_moves(rootMoves);
-    if (rootMoves.empty()) {
-        SearchResult r{}; r.best = 0; r.score = 0; return r;
+void SearchWorker::update_pv(int ply, Move m) {
+    pvTable[ply][ply] = m;
+    for (int i = ply + 1; i < pvLength[ply + 1]; ++i) pvTable[ply][i] = pvTable[ply + 1][i];
+    pvLength[ply] = std::max(pvLength[ply + 1], ply + 1);
+}
+
+// Moves to mate, negative when being mated; 0 for a non-mate score.
+int SearchWorker::mate_moves(int score) {
+    if (std::abs(score) < MATE - MAX_PLY) return 0;
+    return score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2;
+}
+
+// One UCI info line for an iteration; a score outside (alpha, beta) is
+// reported as a bound.
+void SearchWorker::report(int depth, int score, int alpha, int beta) const {
+    if (!owner.infoSink) return;
+    int elapsed = owner.elapsed_ms();
+    uint64_t n = owner.node_count();
+    std::string line = "info depth " + std::to_string(depth) + " seldepth " + std::to_string(selDepth);
+    if (int moves = mate_moves(score)) {
+        line += " score mate " + std::to_string(moves);
+    } else {
+        line += " score cp " + std::to_string(score);
     }
+    if (score >= beta) line += " lowerbound";
+    else if (score <= alpha) line += " upperbound";
+    line += " nodes " + std::to_string(n)
+          + " nps " + std::to_string(n * 1000 / (uint64_t)std::max(1, elapsed))
+          + " hashfull " + std::to_string(owner.hashfull())
+          + " time " + std::to_string(elapsed) + " pv";
+    for (int i = 0; i < pvLength[0]; ++i) line += " " + move_to_string(pvTable[0][i]);
+    owner.infoSink(line);
+}
 
-    int maxDepth = limits.depth > 0 ? limits.depth : 64;
+// Gravity update: the step shrinks as the entry approaches +-HISTORY_MAX,
+// so a table that is never cleared cannot saturate.
+template <typename T>
+static inline void apply_bonus(T &entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+void SearchWorker::update_quiet_stats(Color us, Move m, int bonus, PieceToHistory *cont1, PieceToHistory *cont2) {
+    int to = to_sq(m);
+    Piece pc = make_piece(us, (PieceType)piece_of(m));
+    apply_bonus(history[us][from_sq(m)][to], bonus);
+    if (cont1) apply_bonus((*cont1)[pc][to], bonus);
+    if (cont2) apply_bonus((*cont2)[pc][to], bonus);
+}
+
+void SearchWorker::iterate(const Board &root, int maxDepth) {
+    board = root;
+    board.refresh_accumulator();
+    Board &b = board;
+    bitbaseWins = !bitbase::covers(root);
     int alpha = -INF, beta = INF;
-    Move bestMove = rootMoves[0];
-    int bestScore = -INF;
+    int stableIterations = 0; // consecutive iterations with the same best move
 
     for (rootDepth = 1; rootDepth <= maxDepth; ++rootDepth) {
+        if (id > 0) {
+            int i = (id - 1) % 20;
+            if (((rootDepth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) continue;
+        }
         // Aspiration window
-        if (rootDepth > 4) { alpha = std::max(bestScore - 50, -INF); beta = std::min(bestScore + 50, INF); } else { alpha = -INF; beta = INF; }
+        if (rootDepth > 4 && completedDepth > 0) { alpha = std::max(bestScore - 50, -INF); beta = std::min(bestScore + 50, INF); } else { alpha = -INF; beta = INF; }
         int score;
         while (true) {
             score = search_impl(b, rootDepth, alpha, beta, 0, false, 0);
-            if (stopFlag) break;
-            if (score <= alpha) { alpha -= 150; continue; }
-            if (score >= beta)  { beta  += 150; continue; }
+            if (owner.stopFlag) break;
+            if (id == 0) report(rootDepth, score, alpha, beta);
+            if (score <= alpha) { alpha = std::max(alpha - 150, -INF); continue; }
+            if (score >= beta)  { beta  = std::min(beta + 150, INF); continue; }
             break;
         }
-        if (stopFlag) break;
+        if (owner.stopFlag) break;
 
+        std::copy(pvTable[0], pvTable[0] + pvLength[0], rootPv);
+        rootPvLength = pvLength[0];
+
+        Move prevBest = bestMove;
+        int prevScore = bestScore;
         bestScore = score;
-        // Pick best root move from TT
-        TTEntry e{};
-        if (tt.probe(b.key(), e)) bestMove = e.bestMove ? e.bestMove : bestMove;
+        if (rootBest) bestMove = rootBest;
+        stableIterations = (completedDepth > 0 && bestMove == prevBest) ? stableIterations + 1 : 0;
+        int scoreDrop = completedDepth > 0 ? std::max(0, prevScore - score) : 0;
+        completedDepth = rootDepth;
+
+        if (id == 0) {
+            // Spend less when the best move keeps holding, more when it has
+            // just changed or the score is falling.
+            int scale = 140 - 10 * std::min(stableIterations, 6);
+            scale = scale * (100 + std::min(scoreDrop, 100) / 2) / 100;
+            if (owner.soft_time_up(scale)) break;
+        }
+    }
+}
+
+SearchResult Searcher::search(Board &b, const SearchLimits &limits) {
+    stopFlag = false;
+    pondering = limits.ponder;
+    tt.new_search();
+    update_time(b, limits);
+
+    for (auto &w : workers) w->reset();
 
-        if (time_up()) break;
+    MoveList rootMoves;
+    b.generate_legal_moves(rootMoves);
+    if (rootMoves.empty()) {
+        SearchResult r{}; r.best = 0; r.score = 0; return r;
     }
 
+    int maxDepth = limits.depth > 0 ? limits.depth : 64;
+    for (auto &w : workers) w->bestMove = rootMoves[0];
+
+    std::vector<std::thread> helpers;
+    for (size_t i=1;i<workers.size();++i)
+        helpers.emplace_back([this, i, &b, maxDepth]{ workers[i]->iterate(b, maxDepth); });
+    workers[0]->iterate(b, maxDepth);
+    // UCI forbids sending bestmove during ponder/infinite before stop or ponderhit
+    while (!stopFlag && (pondering || limits.infinite))
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    stopFlag = true;
+    for (auto &t : helpers) t.join();
+
+    // The main thread's move, unless a helper finished a deeper iteration
+    SearchWorker *best = workers[0].get();
+    for (auto &w : workers)
+        if (w->completedDepth > best->completedDepth && w->bestMove) best = w.get();
+
     SearchResult res{};
-    res.best = bestMove;
-    res.score = bestScore;
+    res.best = best->bestMove;
+    res.score = best->bestScore;
+    res.mate = SearchWorker::mate_moves(res.score);
+    res.depth = best->completedDepth;
+    if (best->rootPvLength > 0 && best->rootPv[0] == res.best)
+        res.pv.assign(best->rootPv, best->rootPv + best->rootPvLength);
+    else
+        res.pv.assign(1, res.best);
     return res;
 }
 
 void Searcher::stop() { stopFlag = true; }
-
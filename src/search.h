@@ -2,57 +2,142 @@
 
 #include "board.h"
 #include "tt.h"
+#include "pawns.h"
+#include "movepick.h"
+#include "stats.h"
 #include <vector>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <functional>
+#include <string>
 
 struct SearchLimits {
     int depth = 0;        // max depth (0 = auto)
     int movetime = 0;     // fixed time in ms
     int wtime = 0, btime = 0; // remaining time in ms
     int winc = 0, binc = 0;   // increment in ms
-    int nodes = 0;        // node limit (0 = no limit)
+    int movestogo = 0;    // moves until the next time control (0 = sudden death)
+    uint64_t nodes = 0;   // node limit (0 = no limit)
+    bool infinite = false;    // search until stop
+    bool ponder = false;      // search the predicted move until ponderhit/stop
 };
 
 struct SearchResult {
     Move best = 0;
     int score = 0;
+    int mate = 0;         // moves to mate, negative if mated; 0 for centipawn scores
+    int depth = 0;        // last completed iteration
     std::vector<Move> pv;
 };
 
+class Searcher;
+
+// One Lazy SMP thread: a private Board copy plus its own move-ordering
+// tables. All workers share the owner's transposition table and stop flag.
+class SearchWorker {
+public:
+    SearchWorker(Searcher &owner, int id) : owner(owner), id(id) {}
+
+    void iterate(const Board &root, int maxDepth);
+
+    uint64_t node_count() const { return nodes.load(std::memory_order_relaxed); }
+
+private:
+    friend class Searcher;
+
+    static constexpr int MATE = 32000;
+    static constexpr int INF = MATE + 1;
+    static constexpr int MAX_PLY = 128;
+    static constexpr uint64_t TIME_CHECK_NODES = 1024; // clock poll interval, power of two
+
+    Searcher &owner;
+    int id;
+    Board board;
+    std::atomic<uint64_t> nodes{0};
+    PawnTable pawnTable;
+    SearchStats stats;
+
+    // Move-ordering statistics. Killers are per search; the history tables
+    // persist across the moves of a game and are cleared by new_game().
+    int killerMoves[2][MAX_PLY]{};       // two slots per ply
+    int history[2][64][64]{};            // [side to move][from][to]
+    Move counterMoves[12][64]{};         // refutation of the previous [piece][to]
+    PieceToHistory contHistory[12][64]{}; // indexed by the earlier move's [piece][to]
+    Move pathMoves[MAX_PLY]{};           // move played at each ply (0 for null)
+
+    // Triangular PV table: pvTable[ply][ply..pvLength[ply]) is the line
+    // found from that ply. rootPv keeps the last completed iteration's line.
+    Move pvTable[MAX_PLY][MAX_PLY]{};
+    int pvLength[MAX_PLY]{};
+    Move rootPv[MAX_PLY]{};
+    int rootPvLength = 0;
+    int selDepth = 0;
+    bool bitbaseWins = false; // root is outside the bitbases: cut off won endings
+
+    int rootDepth = 0;
+    int completedDepth = 0;
+    Move rootBest = 0;
+    Move bestMove = 0;
+    int bestScore = 0;
+
+    void reset();
+    void clear_history();
+    void update_quiet_stats(Color us, Move m, int bonus, PieceToHistory *cont1, PieceToHistory *cont2);
+    void check_limits();
+    void count_node() { nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    static int mate_moves(int score); // 0 unless score is a mate score
+    void update_pv(int ply, Move m);
+    void report(int depth, int score, int alpha, int beta) const;
+
+    int qsearch(Board &b, int alpha, int beta, int ply);
+    int search_impl(Board &b, int depth, int alpha, int beta, int ply, bool cutNode, Move parentMove);
+};
+
 class Searcher {
 public:
     Searcher();
     void set_tt_mb(int mb);
+    void set_threads(int n);
     void new_game();
+    // new_game for an unrelated position: history is cleared, and the TT is
+    // hidden rather than zeroed (see TranspositionTable::new_position).
+    void new_position();
 
     SearchResult search(Board &b, const SearchLimits &limits);
     void stop();
+    void ponderhit() { pondering = false; }
+
+    uint64_t node_count() const;
+    int hashfull() const { return tt.hashfull(); }
+    int thread_count() const { return (int)workers.size(); }
+
+    // Counters of the last search merged over all threads (empty unless
+    // built with MAS_STATS).
+    SearchStats stats() const;
+
+    // Receives the UCI "info" lines of the main thread; unset means silent.
+    std::function<void(const std::string &)> infoSink;
 
 private:
-    static constexpr int INF = 30000;
-    static constexpr int MAX_PLY = 128;
+    friend class SearchWorker;
 
     TranspositionTable tt;
     std::atomic<bool> stopFlag{false};
-    std::atomic<uint64_t> nodes{0};
-
-    int killerMoves[2][MAX_PLY]{}; // two slots per ply
-    int history[2][64][64]{};      // piece from->to history heuristic
+    std::atomic<bool> pondering{false};
+    std::vector<std::unique_ptr<SearchWorker>> workers;
 
+    // Soft limit: no new iteration starts past it (scaled by stability).
+    // Hard limit: the running iteration is aborted. 0 means no limit.
     std::chrono::steady_clock::time_point startTime;
-    int timeLimitMs = 0;
-
-    int rootDepth = 0;
-    std::vector<Move> rootMoves;
-    std::vector<Move> bestPV;
+    int softLimitMs = 0;
+    int hardLimitMs = 0;
+    bool timeManaged = false; // clock-based budget that may be rescaled
+    uint64_t nodeLimit = 0;
 
     void update_time(const Board &b, const SearchLimits &limits);
-    bool time_up() const;
-
-    int qsearch(Board &b, int alpha, int beta, int ply);
-    int search_impl(Board &b, int depth, int alpha, int beta, int ply, bool cutNode, Move parentMove);
-    void order_moves(Board &b, std::vector<Move> &moves, Move ttMove, Move parentMove, int ply);
-    int mvv_lva(Move m, const Board &b) const;
+    int elapsed_ms() const;
+    bool hard_time_up() const;
+    bool soft_time_up(int scalePercent) const;
 };
-
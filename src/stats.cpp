@@ -0,0 +1,45 @@
+#include "stats.h"
+
+#ifdef MAS_STATS
+static const char *const STAT_NAMES[ST_COUNT] = {
+    "tt_probes", "tt_hits",
+    "null_tries", "null_cutoffs",
+    "futility_prunes",
+    "lmr_researches",
+    "cutoffs", "first_move_cutoffs",
+    "qsearch_nodes",
+    "bitbase_hits",
+};
+
+// Trailing empty buckets are dropped to keep the output short
+static void write_array(const uint64_t (&v)[SearchStats::BUCKETS], std::ostream &out) {
+    int last = SearchStats::BUCKETS;
+    while (last > 0 && !v[last - 1]) --last;
+    out << "[";
+    for (int i = 0; i < last; ++i) out << (i ? "," : "") << v[i];
+    out << "]";
+}
+
+void write_stats_json(const SearchStats &s, int threads, std::ostream &out) {
+    out << "{\"enabled\":true,\"threads\":" << threads;
+    uint64_t totals[ST_COUNT] = {};
+    for (int c = 0; c < ST_COUNT; ++c)
+        for (int i = 0; i < SearchStats::BUCKETS; ++i) totals[c] += s.byPly[c][i];
+    for (int c = 0; c < ST_COUNT; ++c) {
+        out << ",\"" << STAT_NAMES[c] << "\":{\"total\":" << totals[c] << ",\"by_depth\":";
+        write_array(s.byDepth[c], out);
+        out << ",\"by_ply\":";
+        write_array(s.byPly[c], out);
+        out << "}";
+    }
+    auto rate = [](uint64_t a, uint64_t b) { return b ? (double)a / (double)b : 0.0; };
+    out << ",\"tt_hit_rate\":" << rate(totals[ST_TT_HIT], totals[ST_TT_PROBE])
+        << ",\"null_cutoff_rate\":" << rate(totals[ST_NULL_CUTOFF], totals[ST_NULL_TRY])
+        << ",\"first_move_cutoff_rate\":" << rate(totals[ST_FIRST_MOVE_CUTOFF], totals[ST_CUTOFF])
+        << "}" << std::endl;
+}
+#else
+void write_stats_json(const SearchStats &, int, std::ostream &out) {
+    out << "{\"enabled\":false}" << std::endl;
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Search statistics, compiled in only with -DMAS_STATS. Without the flag
+// SearchStats is empty and every update is an inline no-op. Each worker
+// owns one, so counting never touches shared cache lines; the Searcher
+// merges them when asked.
+enum StatCounter {
+    ST_TT_PROBE, ST_TT_HIT,
+    ST_NULL_TRY, ST_NULL_CUTOFF,
+    ST_FUTILITY_PRUNE,
+    ST_LMR_RESEARCH,
+    ST_CUTOFF, ST_FIRST_MOVE_CUTOFF,
+    ST_QS_NODE,
+    ST_BITBASE_HIT,
+    ST_COUNT
+};
+
+struct SearchStats {
+    static constexpr int BUCKETS = 64; // depth and ply, deeper ones share the last bucket
+
+#ifdef MAS_STATS
+    uint64_t byDepth[ST_COUNT][BUCKETS] = {};
+    uint64_t byPly[ST_COUNT][BUCKETS] = {};
+
+    void add(StatCounter c, int depth, int ply) {
+        ++byDepth[c][depth < 0 ? 0 : depth < BUCKETS ? depth : BUCKETS - 1];
+        ++byPly[c][ply < BUCKETS ? ply : BUCKETS - 1];
+    }
+    void clear() { *this = SearchStats(); }
+    void merge(const SearchStats &o) {
+        for (int c = 0; c < ST_COUNT; ++c)
+            for (int i = 0; i < BUCKETS; ++i) {
+                byDepth[c][i] += o.byDepth[c][i];
+                byPly[c][i] += o.byPly[c][i];
+            }
+    }
+#else
+    void add(StatCounter, int, int) {}
+    void clear() {}
+    void merge(const SearchStats &) {}
+#endif
+};
+
+// One JSON object with totals and per-depth/per-ply arrays for every
+// counter, or {"enabled":false} in builds without MAS_STATS.
+void write_stats_json(const SearchStats &s, int threads, std::ostream &out);
@@ -1,5 +1,12 @@
 #include "tt.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 static constexpr int MATE_SCORE = 32000;
 static constexpr int MATE_BOUND = 31000;
@@ -16,37 +23,127 @@ int score_from_tt(int score, int ply) {
     return score;
 }
 
-void TranspositionTable::resize_mb(size_t mb) {
-    size_t bytes = mb * 1024ull * 1024ull;
-    size_t n = bytes / sizeof(TTEntry);
+static inline uint32_t check_word(uint64_t key, uint64_t data) {
+    return (uint32_t)(key >> 32) ^ (uint32_t)data ^ (uint32_t)(data >> 32);
+}
+
+static inline int entry_depth(uint64_t data) { return (int)((data >> 48) & 0xFF) - 1; }
+static inline int entry_gen(uint64_t data) { return (int)(data >> 58); }
+
+static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+TranspositionTable::~TranspositionTable() {
+    std::free(table);
+}
+
+void TranspositionTable::resize_mb(size_t mb, int threads) {
+    std::free(table);
+    table = nullptr;
+    size_t want = mb * 1024ull * 1024ull;
+    size_t n = want / sizeof(TTBucket);
     if (n == 0) n = 1;
-    // round up to power of two
-    size_t p = 1; while (p < n) p <<= 1;
-    table.assign(p, {});
+    // round down to power of two so the table never exceeds the budget
+    size_t p = 1; while (p * 2 <= n) p <<= 1;
+    bytes = p * sizeof(TTBucket);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    size_t alloc = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    table = static_cast<TTBucket *>(std::aligned_alloc(HUGE_PAGE, alloc));
+    if (!table) { bytes = 0; mask = 0; return; }
+#if defined(MADV_HUGEPAGE)
+    madvise(table, alloc, MADV_HUGEPAGE);
+#endif
     mask = p - 1;
+    clear(threads);
 }
 
-void TranspositionTable::clear() {
-    std::fill(table.begin(), table.end(), TTEntry{});
+void TranspositionTable::clear(int threads) {
+    generation = 0;
+    isolated = false;
+    if (!table) return;
+    // Zeroing also faults the pages in, so split it across threads; each
+    // thread touches its own range, which spreads the pages across NUMA nodes.
+    threads = std::max(1, threads);
+    size_t chunk = (bytes / threads + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        size_t begin = (size_t)t * chunk;
+        if (begin >= bytes) break;
+        size_t len = std::min(chunk, bytes - begin);
+        char *base = reinterpret_cast<char *>(table) + begin;
+        if (t == threads - 1 || begin + len >= bytes) std::memset(base, 0, len);
+        else pool.emplace_back([base, len]{ std::memset(base, 0, len); });
+    }
+    for (auto &th : pool) th.join();
 }
 
-void TranspositionTable::store(uint64_t key, int depth, int score, uint8_t flag, Move best) {
-    if (table.empty()) return;
-    size_t idx = key & mask;
-    TTEntry &e = table[idx];
-    if (e.depth <= depth || e.key != key) {
-        e.key = key;
-        e.depth = (int8_t)depth;
-        e.score = (int16_t)score;
-        e.flag = flag;
-        e.bestMove = best;
+void TranspositionTable::new_position() {
+    // Every generation since the last clear belongs to an earlier position
+    if (generation == 63) clear();
+    isolated = true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, int eval, uint8_t flag, Move best) {
+    if (!table) return;
+    TTBucket &b = bucket(key);
+
+    // Same position if present, otherwise the entry with the lowest
+    // depth - 8 * age (stale entries from earlier searches go first).
+    int slot = 0, worst = 1 << 30;
+    uint64_t old = 0;
+    for (int i=0;i<TTBucket::ENTRIES;++i) {
+        uint64_t d = b.data[i].load(std::memory_order_relaxed);
+        if (isolated && entry_gen(d) != generation) {
+            d = 0; // replaced exactly like an empty slot
+        } else if (check_word(key, d) == b.check[i].load(std::memory_order_relaxed) && entry_depth(d) >= 0) {
+            slot = i; old = d;
+            break;
+        }
+        int age = (generation - entry_gen(d)) & 63;
+        int value = entry_depth(d) - 8 * age;
+        if (value < worst) { worst = value; slot = i; old = 0; }
+    }
+
+    if (old) {
+        // Keep a deeper result for the same position unless the new one is exact
+        if (flag != TT_EXACT && depth + 3 < entry_depth(old)) return;
+        if (!best) best = move16((Move)old);
     }
+
+    uint64_t data = (uint64_t)move16(best)
+                  | ((uint64_t)(uint16_t)(int16_t)score << 16)
+                  | ((uint64_t)(uint16_t)(int16_t)eval << 32)
+                  | ((uint64_t)(uint8_t)(depth + 1) << 48)
+                  | ((uint64_t)(flag & 3) << 56)
+                  | ((uint64_t)generation << 58);
+    b.data[slot].store(data, std::memory_order_relaxed);
+    b.check[slot].store(check_word(key, data), std::memory_order_relaxed);
 }
 
 bool TranspositionTable::probe(uint64_t key, TTEntry &out) const {
-    if (table.empty()) return false;
-    const TTEntry &e = table[key & mask];
-    if (e.key == key && e.depth >= 0) { out = e; return true; }
+    if (!table) return false;
+    const TTBucket &b = bucket(key);
+    for (int i=0;i<TTBucket::ENTRIES;++i) {
+        uint64_t d = b.data[i].load(std::memory_order_relaxed);
+        if (check_word(key, d) != b.check[i].load(std::memory_order_relaxed) || entry_depth(d) < 0) continue;
+        if (isolated && entry_gen(d) != generation) continue;
+        out.bestMove = move16((Move)d);
+        out.score = (int16_t)(d >> 16);
+        out.eval = (int16_t)(d >> 32);
+        out.depth = (int8_t)entry_depth(d);
+        out.flag = (uint8_t)((d >> 56) & 3);
+        return true;
+    }
     return false;
 }
 
+int TranspositionTable::hashfull() const {
+    size_t buckets = std::min<size_t>(mask + 1, 200);
+    if (!buckets) return 0;
+    int used = 0;
+    for (size_t i=0;i<buckets;++i)
+        for (int j=0;j<TTBucket::ENTRIES;++j) {
+            uint64_t d = table[i].data[j].load(std::memory_order_relaxed);
+            if (entry_depth(d) >= 0 && entry_gen(d) == generation) ++used;
+        }
+    return (int)(used * 1000 / (buckets * TTBucket::ENTRIES));
+}
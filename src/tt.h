@@ -1,31 +1,61 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
-#include <vector>
 #include "common.h"
 
 enum TTFlag : uint8_t { TT_EXACT = 0, TT_ALPHA = 1, TT_BETA = 2 };
 
+// Unpacked view of a table entry returned by probe. bestMove holds only the
+// from/to/promo bits (see move16); callers match it against generated moves.
 struct TTEntry {
-    uint64_t key = 0;
     int16_t score = 0;
+    int16_t eval = 0;
     int8_t depth = -1;
     uint8_t flag = TT_ALPHA;
     Move bestMove = 0;
 };
 
+// 64-byte bucket of five entries. Each entry is one packed 64-bit data word
+// plus a 32-bit check word holding (key >> 32) xor both halves of the data,
+// so a torn write from another thread simply fails verification.
+//   data bits  0..14 move16, 15 zero, 16..31 score, 32..47 eval,
+//              48..55 depth + 1, 56..57 bound, 58..63 generation
+struct alignas(64) TTBucket {
+    static constexpr int ENTRIES = 5;
+    std::atomic<uint32_t> check[ENTRIES];
+    std::atomic<uint64_t> data[ENTRIES];
+};
+
 class TranspositionTable {
 public:
-    void resize_mb(size_t mb);
-    void clear();
-    void store(uint64_t key, int depth, int score, uint8_t flag, Move best);
+    TranspositionTable() = default;
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    void resize_mb(size_t mb, int threads = 1);
+    void clear(int threads = 1);
+    void prefetch(uint64_t key) const { __builtin_prefetch(&table[key & mask]); }
+    void new_search() { generation = (generation + 1) & 63; }
+    // For a search that must not see anything stored before it: entries of
+    // other generations then read as empty, exactly as after clear(), which
+    // only runs for real once the 6-bit generation would wrap.
+    void new_position();
+    void store(uint64_t key, int depth, int score, int eval, uint8_t flag, Move best);
     bool probe(uint64_t key, TTEntry &out) const;
+    int hashfull() const; // permille of sampled entries written by the current search
 
 private:
-    std::vector<TTEntry> table;
+    TTBucket *table = nullptr;   // 2 MB aligned, huge-page backed where available
+    size_t bytes = 0;
     size_t mask = 0;
+    uint8_t generation = 0;
+    bool isolated = false;       // set by new_position until the next clear
+
+    const TTBucket &bucket(uint64_t key) const { return table[key & mask]; }
+    TTBucket &bucket(uint64_t key) { return table[key & mask]; }
 };
 
 int score_to_tt(int score, int ply);
 int score_from_tt(int score, int ply);
-
@@ -1,20 +1,83 @@
 #include "uci.h"
+#include "perft.h"
+#include "bench.h"
+#include "nnue.h"
+#include "book.h"
+#include "bitbase.h"
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <mutex>
 
-UCI::UCI() {}
+void uci_send(const std::string &line) {
+    static std::mutex ioMutex;
+    std::lock_guard<std::mutex> lock(ioMutex);
+    std::cout << line << std::endl;
+}
+
+UCI::UCI() { searcher.infoSink = uci_send; }
+
+UCI::~UCI() {
+    stop_search();
+    if (bitbaseThread.joinable()) bitbaseThread.join();
+}
+
+void UCI::wait_for_search() {
+    if (searchThread.joinable()) searchThread.join();
+}
+
+// For commands that change what is searched: an infinite or ponder search
+// would otherwise never return from the join. The stop is repeated because
+// a search thread that has not yet entered search() clears the flag.
+void UCI::stop_search() {
+    while (searching) {
+        searcher.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    wait_for_search();
+}
+
+// Commands that would otherwise join the search thread are skipped while it
+// runs: after 'go infinite' or 'go ponder' that join never returns.
+bool UCI::refuse_while_searching(const char *cmd) {
+    if (!searching) return false;
+    uci_send(std::string("info string ") + cmd + " ignored while searching");
+    return true;
+}
+
+// Generation starts on the first isready or go rather than at launch, so a
+// BitbaseFile sent with the other options can be mapped instead. Searches
+// meanwhile use whichever tables are finished.
+void UCI::start_bitbases() {
+    if (bitbaseThread.joinable() || bitbase::ready()) return;
+    int threads = searcher.thread_count();
+    bitbaseThread = std::thread([threads] {
+        std::string err;
+        if (!bitbase::init(threads, "", err)) uci_send("info string " + err);
+    });
+}
 
 void UCI::cmd_uci() {
-    std::cout << "id name MasChess" << std::endl;
-    std::cout << "id author OpenAI" << std::endl;
-    std::cout << "option name Hash type spin default 64 min 1 max 2048" << std::endl;
-    std::cout << "uciok" << std::endl;
+    uci_send("id name MasChess");
+    uci_send("id author OpenAI");
+    uci_send("option name Hash type spin default 64 min 1 max 2048");
+    uci_send("option name Threads type spin default 1 min 1 max 256");
+    uci_send("option name Ponder type check default false");
+    uci_send("option name EvalFile type string default <empty>");
+    uci_send("option name Book type check default false");
+    uci_send("option name BookFile type string default <empty>");
+    uci_send("option name BitbaseFile type string default <empty>");
+    uci_send("uciok");
 }
 
-void UCI::cmd_isready() { std::cout << "readyok" << std::endl; }
+void UCI::cmd_isready() {
+    start_bitbases();
+    uci_send("readyok");
+}
 
 void UCI::cmd_ucinewgame() {
+    stop_search();
     searcher.new_game();
 }
 
@@ -40,7 +103,7 @@ bool UCI::parse_move_str(const std::string &mstr, Move &outMove) {
     int promo = 0;
     if (mstr.size() >= 5) promo = promo_char_to_piece(mstr[4]);
 
-    std::vector<Move> legal; legal.reserve(256);
+    MoveList legal;
     board.generate_legal_moves(legal);
     for (Move m : legal) {
         if (from_sq(m)==from && to_sq(m)==to) {
@@ -55,6 +118,7 @@ bool UCI::parse_move_str(const std::string &mstr, Move &outMove) {
 }
 
 void UCI::cmd_position(const std::string &args) {
+    stop_search();
     std::istringstream ss(args);
     std::string tok; ss >> tok;
     if (tok == "startpos") {
@@ -83,6 +147,32 @@ void UCI::cmd_position(const std::string &args) {
     }
 }
 
+// bench [depth] [hash MB] [threads]; uses its own searcher, so the game's
+// TT and history are left alone.
+void UCI::cmd_bench(const std::string &args) {
+    BenchOptions opts;
+    std::istringstream ss(args);
+    ss >> opts.depth >> opts.hashMb >> opts.threads;
+    if (refuse_while_searching("bench")) return;
+    wait_for_search();
+    bench(opts, std::cout);
+}
+
+// makebook <input.pgn|input.epd> <output.bin> [plies N] [memory MB]
+void UCI::cmd_makebook(const std::string &args) {
+    std::istringstream ss(args);
+    std::string in, out, tok;
+    book::MakeBookOptions opts;
+    ss >> in >> out;
+    while (ss >> tok)
+        if (tok == "plies") ss >> opts.maxPly;
+        else if (tok == "memory") ss >> opts.memoryMb;
+    if (refuse_while_searching("makebook")) return;
+    wait_for_search();
+    std::string err;
+    if (!book::make_book(in, out, opts, std::cout, err)) uci_send("info string " + err);
+}
+
 void UCI::cmd_setoption(const std::string &args) {
     std::istringstream ss(args);
     std::string name, tok;
@@ -93,9 +183,34 @@ void UCI::cmd_setoption(const std::string &args) {
     while (ss >> tok && tok != "value") {}
     std::getline(ss, value);
     if (!value.empty() && value[0]==' ') value.erase(0,1);
+    stop_search();
     if (name == "Hash") {
         int mb = std::max(1, std::min(2048, std::stoi(value)));
         searcher.set_tt_mb(mb);
+    } else if (name == "Threads") {
+        int n = std::max(1, std::min(256, std::stoi(value)));
+        searcher.set_threads(n);
+    } else if (name == "EvalFile") {
+        std::string err;
+        bool hadNet = nnue::enabled();
+        if (!nnue::load(value, err)) uci_send("info string " + err);
+        else {
+            if (nnue::enabled()) uci_send("info string loaded network " + value);
+            // Stored static evals are on the old evaluator's scale
+            if (hadNet || nnue::enabled()) searcher.new_game();
+        }
+        board.refresh_accumulator();
+    } else if (name == "Book") {
+        useBook = value == "true";
+    } else if (name == "BookFile") {
+        std::string err;
+        if (!book::load(value, err)) uci_send("info string " + err);
+        else if (book::loaded()) uci_send("info string loaded book " + value);
+    } else if (name == "BitbaseFile") {
+        // Maps the cache, or generates the tables and writes it
+        if (bitbaseThread.joinable()) bitbaseThread.join();
+        std::string err;
+        if (!bitbase::init(searcher.thread_count(), value, err)) uci_send("info string " + err);
     }
 }
 
@@ -103,25 +218,53 @@ void UCI::cmd_go(const std::string &args) {
     SearchLimits limits{};
     std::istringstream ss(args);
     std::string tok;
+    if (ss >> tok && tok == "perft") {
+        // go perft <depth> [threads <n>] [hash <mb>]
+        PerftOptions opts;
+        ss >> opts.depth;
+        while (ss >> tok) {
+            if (tok == "threads") ss >> opts.threads;
+            else if (tok == "hash") ss >> opts.hashMb;
+        }
+        if (refuse_while_searching("go perft")) return;
+        wait_for_search();
+        perft_divide(board, opts, std::cout);
+        return;
+    }
+    ss.clear(); ss.str(args);
     while (ss >> tok) {
         if (tok == "wtime") ss >> limits.wtime;
         else if (tok == "btime") ss >> limits.btime;
         else if (tok == "winc") ss >> limits.winc;
         else if (tok == "binc") ss >> limits.binc;
+        else if (tok == "movestogo") ss >> limits.movestogo;
         else if (tok == "movetime") ss >> limits.movetime;
         else if (tok == "depth") ss >> limits.depth;
         else if (tok == "nodes") ss >> limits.nodes;
-        else if (tok == "infinite") { limits.wtime = limits.btime = limits.movetime = 0; }
+        else if (tok == "infinite") { limits.infinite = true; limits.wtime = limits.btime = limits.movetime = 0; }
+        else if (tok == "ponder") limits.ponder = true;
     }
-    auto res = searcher.search(board, limits);
-    std::cout << "bestmove " << square_to_string((Square)from_sq(res.best))
-              << square_to_string((Square)to_sq(res.best));
-    if (is_promo(res.best)) {
-        int p = promo_of(res.best);
-        char pc = (p==QUEEN?'q': p==ROOK?'r': p==BISHOP?'b':'n');
-        std::cout << pc;
+    stop_search();
+    start_bitbases();
+    // Book moves are answered at once; analysis and pondering always search
+    if (useBook && !limits.infinite && !limits.ponder) {
+        if (Move m = book::probe(board)) {
+            uci_send("info string book move");
+            uci_send("bestmove " + move_to_string(m));
+            return;
+        }
     }
-    std::cout << std::endl;
+    // The search runs on its own thread so the input loop keeps reading
+    // stop/ponderhit/isready while it thinks.
+    searching = true;
+    searchThread = std::thread([this, limits]{
+        auto res = searcher.search(board, limits);
+        std::string line = "bestmove " + move_to_string(res.best);
+        if (res.pv.size() > 1) line += " ponder " + move_to_string(res.pv[1]);
+        // Cleared first, so a command sent in reply to bestmove is not refused
+        searching = false;
+        uci_send(line);
+    });
 }
 
 void UCI::loop() {
@@ -136,8 +279,17 @@ void UCI::loop() {
         else if (line == "ucinewgame") cmd_ucinewgame();
         else if (line.rfind("position", 0) == 0) cmd_position(line.substr(9));
         else if (line.rfind("go", 0) == 0) cmd_go(line.substr(2));
-        else if (line == "stop") searcher.stop();
+        else if (line.rfind("bench", 0) == 0) cmd_bench(line.substr(5));
+        else if (line.rfind("makebook", 0) == 0) cmd_makebook(line.substr(8));
+        else if (line == "stats") {
+            if (refuse_while_searching("stats")) continue;
+            wait_for_search();
+            write_stats_json(searcher.stats(), searcher.thread_count(), std::cout);
+        }
+        else if (line == "stop") stop_search();
+        else if (line == "ponderhit") searcher.ponderhit();
         else if (line == "quit") break;
     }
+    stop_search();
 }
 
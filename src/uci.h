@@ -1,17 +1,27 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include "board.h"
 #include "search.h"
 
+// Writes one complete line to stdout; safe to call from the search thread.
+void uci_send(const std::string &line);
+
 class UCI {
 public:
     UCI();
+    ~UCI();
     void loop();
 
 private:
     Board board;
     Searcher searcher;
+    std::thread searchThread;
+    std::atomic<bool> searching{false}; // set until the search thread is about to send bestmove
+    std::thread bitbaseThread; // builds the bitbases in the background
+    bool useBook = false;
 
     void cmd_uci();
     void cmd_isready();
@@ -19,6 +29,12 @@ private:
     void cmd_position(const std::string &args);
     void cmd_go(const std::string &args);
     void cmd_setoption(const std::string &args);
+    void cmd_bench(const std::string &args);
+    void cmd_makebook(const std::string &args);
+    void wait_for_search();
+    void stop_search();
+    bool refuse_while_searching(const char *cmd);
+    void start_bitbases();
 
     bool parse_move_str(const std::string &mstr, Move &outMove);
 };
@@ -0,0 +1,69 @@
+// Checks that the search does no heap allocation per node. Every operator
+// new is counted; a fixed-depth search may allocate only what a depth-1
+// search of the same position does (the result PV, helper threads), so any
+// difference means something in the tree allocates.
+#include "board.h"
+#include "search.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t n, std::align_val_t al) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t a = (size_t)al;
+    if (void *p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+static const char *const FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+};
+
+static uint64_t search_allocations(Searcher &searcher, const char *fen, int depth) {
+    Board b;
+    b.set_fen(fen);
+    SearchLimits limits{};
+    limits.depth = depth;
+    searcher.new_game();
+    uint64_t before = allocations.load();
+    searcher.search(b, limits);
+    return allocations.load() - before;
+}
+
+int main() {
+    const int depth = 9;
+    int failures = 0;
+    for (int threads : {1, 2}) {
+        Searcher searcher;
+        searcher.set_tt_mb(16);
+        searcher.set_threads(threads);
+        for (const char *fen : FENS) {
+            uint64_t base = search_allocations(searcher, fen, 1);
+            uint64_t full = search_allocations(searcher, fen, depth);
+            bool ok = full == base;
+            if (!ok) ++failures;
+            std::cout << (ok ? "ok   " : "FAIL ") << "threads " << threads << " depth " << depth << ": "
+                      << (int64_t)(full - base) << " extra allocations  " << fen << "\n";
+        }
+    }
+    std::cout << "\n" << failures << " failures\n";
+    return failures ? 1 : 0;
+}